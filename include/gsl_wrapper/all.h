@@ -1,4 +1,16 @@
 #pragma once
 
+#include "deferred.h"
+#include "eigen.h"
+#include "fft.h"
+#include "interop.h"
+#include "kronecker.h"
+#include "krylov.h"
+#include "matrix-batch.h"
 #include "matrix.h"
+#include "nonlinear-least-squares.h"
+#include "ode.h"
+#include "spline.h"
+#include "svd.h"
+#include "tiled-matrix.h"
 #include "vector.h"
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <exception>
+#include <utility>
+
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_matrix.h>
+
+#include "../vector.h"
+#include "thread-pool.h"
+
+namespace gsl_wrapper::bits
+{
+  // The void *params handed to a GSL callback: the C++ object the callback
+  // forwards to, and the exception it threw
+  //
+  // C++ exceptions must not unwind through the C frames of GSL. call() turns
+  // one into GSL_EBADFUNC for GSL to return, finish() rethrows it after.
+  // Only the first exception is kept, later ones are usually its fallout.
+  template <typename Target>
+  struct CallbackState
+  {
+    const Target *target = nullptr;
+    std::exception_ptr error;
+
+    auto start(const Target &new_target) -> void;
+    template <typename Body>
+    auto call(Body &&body) -> int;
+    auto finish() -> void;
+  };
+
+  template <typename Target>
+  inline auto CallbackState<Target>::start(const Target &new_target) -> void
+  {
+    target = &new_target;
+    error = nullptr;
+  }
+
+  template <typename Target>
+  template <typename Body>
+  inline auto CallbackState<Target>::call(Body &&body) -> int
+  {
+    try
+    {
+      body(*target);
+    }
+    catch (...)
+    {
+      if (!error)
+        error = std::current_exception();
+      return GSL_EBADFUNC;
+    }
+    return GSL_SUCCESS;
+  }
+
+  template <typename Target>
+  inline auto CallbackState<Target>::finish() -> void
+  {
+    target = nullptr;
+    if (error)
+      std::rethrow_exception(std::exchange(error, nullptr));
+  }
+
+  // Calls solve(worker, i, row) for every row of rows on the shared pool,
+  // with row a view of the first row_size elements of row i. Each thread
+  // builds one worker with make_worker() and keeps it for its block of rows.
+  template <typename MakeWorker, typename Solve>
+  inline auto solve_rows(gsl_matrix *rows, size_t row_size, MakeWorker make_worker, Solve solve) -> void
+  {
+    ThreadPool::shared().parallel_for(rows->size1, [&](size_t begin, size_t end)
+                                      {
+                                        auto worker = make_worker();
+                                        for (size_t i = begin; i < end; i++)
+                                        {
+                                          Vector row = Vector::view(rows->data + i * rows->tda, row_size);
+                                          solve(worker, i, row);
+                                        } });
+  }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+
+#include <gsl/gsl_errno.h>
+
+namespace gsl_wrapper::bits
+{
+  // Switches GSL's error handler off for as long as any instance lives, so
+  // failing routines return their status instead of aborting
+  //
+  // The handler is process wide. The first guard saves the handler in place
+  // and the last one to go restores it, so GSL called directly from other
+  // threads in the meantime returns status codes as well.
+  class ErrorHandlerOff
+  {
+  public:
+    ErrorHandlerOff();
+    ~ErrorHandlerOff();
+
+    ErrorHandlerOff(const ErrorHandlerOff &copy_from) = delete;
+    auto operator=(const ErrorHandlerOff &copy_from) -> ErrorHandlerOff & = delete;
+
+  private:
+    struct State
+    {
+      std::mutex mutex;
+      size_t guards = 0;
+      gsl_error_handler_t *previous = nullptr;
+    };
+
+    static auto state() -> State &;
+  };
+
+  inline ErrorHandlerOff::ErrorHandlerOff()
+  {
+    State &shared = state();
+    std::lock_guard<std::mutex> lock{shared.mutex};
+    if (shared.guards++ == 0)
+      shared.previous = gsl_set_error_handler_off();
+  }
+
+  inline ErrorHandlerOff::~ErrorHandlerOff()
+  {
+    State &shared = state();
+    std::lock_guard<std::mutex> lock{shared.mutex};
+    if (--shared.guards == 0)
+      gsl_set_error_handler(shared.previous);
+  }
+
+  inline auto ErrorHandlerOff::state() -> State &
+  {
+    static State instance;
+    return instance;
+  }
+
+  // Status codes only reach this with an ErrorHandlerOff alive
+  inline auto check_status(int status) -> void
+  {
+    if (status != GSL_SUCCESS)
+      throw std::runtime_error{gsl_strerror(status)};
+  }
+}
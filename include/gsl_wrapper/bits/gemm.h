@@ -0,0 +1,223 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <gsl/gsl_blas.h>
+#include <gsl/gsl_matrix.h>
+
+#include "thread-pool.h"
+
+namespace gsl_wrapper::bits
+{
+  // Blocking of the built-in GEMM in the GotoBLAS/BLIS scheme
+  //
+  // The micro-kernel keeps a gemm_mr x gemm_nr block of C in registers, a
+  // gemm_kc x gemm_nr panel of B is sized for the L1 cache, a gemm_mc x
+  // gemm_kc block of A for the L2 cache and gemm_kc x gemm_nc of B for L3.
+  constexpr size_t gemm_mr = 4;
+  constexpr size_t gemm_nr = 8;
+  constexpr size_t gemm_kc = 256;
+  constexpr size_t gemm_mc = 96;
+  constexpr size_t gemm_nc = 4080;
+
+  // Products smaller than this many multiply-adds stay on the calling thread
+  constexpr size_t gemm_parallel_threshold = size_t{1} << 18;
+
+  // Element (i, j) of a matrix sits at data[i * row_stride + j * collumn_stride]
+  struct StridedOperand
+  {
+    const double *data;
+    size_t row_stride;
+    size_t collumn_stride;
+  };
+
+  // Copies rows [row, row + mr) of the kc collumns starting at `depth` of A
+  // into consecutive gemm_mr wide slivers, padding the missing rows with zeros
+  inline auto gemm_pack_a(StridedOperand a, size_t row, size_t depth, size_t mr, size_t kc, double *packed) -> void
+  {
+    for (size_t p = 0; p < kc; p++)
+    {
+      const double *source = a.data + row * a.row_stride + (depth + p) * a.collumn_stride;
+      for (size_t i = 0; i < gemm_mr; i++)
+        packed[p * gemm_mr + i] = i < mr ? source[i * a.row_stride] : 0.0;
+    }
+  }
+
+  // Copies collumns [collumn, collumn + nr) of the kc rows starting at `depth`
+  // of B into consecutive gemm_nr wide slivers, padding with zeros
+  inline auto gemm_pack_b(StridedOperand b, size_t depth, size_t collumn, size_t nr, size_t kc, double *packed) -> void
+  {
+    for (size_t p = 0; p < kc; p++)
+    {
+      const double *source = b.data + (depth + p) * b.row_stride + collumn * b.collumn_stride;
+      for (size_t j = 0; j < gemm_nr; j++)
+        packed[p * gemm_nr + j] = j < nr ? source[j * b.collumn_stride] : 0.0;
+    }
+  }
+
+  // C[0:mr, 0:nr] = alpha A B + beta C for one packed sliver pair, beta of
+  // zero never reads C
+  inline auto gemm_micro_kernel(size_t kc, const double *a, const double *b, double alpha, double beta,
+                                double *c, size_t ldc, size_t mr, size_t nr) -> void
+  {
+    double block[gemm_mr][gemm_nr];
+
+#if defined(__GNUC__) || defined(__clang__)
+    // Four doubles per lane, compiled to AVX registers when available and to
+    // pairs of SSE2 registers otherwise
+    typedef double Lane __attribute__((vector_size(4 * sizeof(double))));
+    constexpr size_t lanes_per_row = gemm_nr / 4;
+
+    Lane accumulator[gemm_mr][lanes_per_row] = {};
+    for (size_t p = 0; p < kc; p++)
+    {
+      Lane b_lane[lanes_per_row];
+      std::memcpy(b_lane, b + p * gemm_nr, sizeof(b_lane));
+      for (size_t i = 0; i < gemm_mr; i++)
+      {
+        const double a_ip = a[p * gemm_mr + i];
+        for (size_t l = 0; l < lanes_per_row; l++)
+          accumulator[i][l] += a_ip * b_lane[l];
+      }
+    }
+    std::memcpy(block, accumulator, sizeof(block));
+#else
+    for (size_t i = 0; i < gemm_mr; i++)
+    {
+      for (size_t j = 0; j < gemm_nr; j++)
+        block[i][j] = 0.0;
+    }
+    for (size_t p = 0; p < kc; p++)
+    {
+      for (size_t i = 0; i < gemm_mr; i++)
+      {
+        for (size_t j = 0; j < gemm_nr; j++)
+          block[i][j] += a[p * gemm_mr + i] * b[p * gemm_nr + j];
+      }
+    }
+#endif
+
+    for (size_t i = 0; i < mr; i++)
+    {
+      double *c_i = c + i * ldc;
+      for (size_t j = 0; j < nr; j++)
+        c_i[j] = beta == 0.0 ? alpha * block[i][j] : alpha * block[i][j] + beta * c_i[j];
+    }
+  }
+
+  // C = alpha op(A) op(B) + beta C with the same arguments as gsl_blas_dgemm
+  //
+  // B is packed once per gemm_kc x gemm_nc block and shared, the row blocks
+  // of A are packed and multiplied by the threads of the shared pool.
+  inline auto blocked_gemm(CBLAS_TRANSPOSE_t trans_a, CBLAS_TRANSPOSE_t trans_b, double alpha,
+                           const gsl_matrix *a, const gsl_matrix *b, double beta, gsl_matrix *c) -> void
+  {
+    const bool transpose_a = trans_a != CblasNoTrans;
+    const bool transpose_b = trans_b != CblasNoTrans;
+    const size_t m = transpose_a ? a->size2 : a->size1;
+    const size_t k = transpose_a ? a->size1 : a->size2;
+    const size_t n = transpose_b ? b->size1 : b->size2;
+
+    if ((transpose_b ? b->size2 : b->size1) != k || c->size1 != m || c->size2 != n)
+      throw std::range_error{"Diffrent sizes of matrices in gemm"};
+    if (m == 0 || n == 0)
+      return;
+
+    if (k == 0 || alpha == 0.0)
+    {
+      for (size_t i = 0; i < m; i++)
+      {
+        double *c_i = c->data + i * c->tda;
+        for (size_t j = 0; j < n; j++)
+          c_i[j] = beta == 0.0 ? 0.0 : beta * c_i[j];
+      }
+      return;
+    }
+
+    const StridedOperand op_a = transpose_a ? StridedOperand{a->data, 1, a->tda} : StridedOperand{a->data, a->tda, 1};
+    const StridedOperand op_b = transpose_b ? StridedOperand{b->data, 1, b->tda} : StridedOperand{b->data, b->tda, 1};
+
+    ThreadPool &pool = ThreadPool::shared();
+    const bool parallel = m * n * k >= gemm_parallel_threshold && pool.size() > 1;
+
+    // Smaller row blocks when there are too few of them to keep every thread busy
+    size_t mc = gemm_mc;
+    if (parallel)
+    {
+      const size_t rows_per_thread = (m + pool.size() - 1) / pool.size();
+      mc = std::max(gemm_mr, std::min(gemm_mc, (rows_per_thread + gemm_mr - 1) / gemm_mr * gemm_mr));
+    }
+    const size_t num_row_blocks = (m + mc - 1) / mc;
+
+    std::vector<double> packed_b(std::min(gemm_kc, k) * ((std::min(gemm_nc, n) + gemm_nr - 1) / gemm_nr * gemm_nr));
+
+    for (size_t jc = 0; jc < n; jc += gemm_nc)
+    {
+      const size_t nc = std::min(gemm_nc, n - jc);
+      const size_t num_slivers = (nc + gemm_nr - 1) / gemm_nr;
+
+      for (size_t pc = 0; pc < k; pc += gemm_kc)
+      {
+        const size_t kc = std::min(gemm_kc, k - pc);
+        // Only the first pass over k scales the old values of C
+        const double beta_pass = pc == 0 ? beta : 1.0;
+
+        auto pack_b = [&](size_t begin, size_t end)
+        {
+          for (size_t s = begin; s < end; s++)
+            gemm_pack_b(op_b, pc, jc + s * gemm_nr, std::min(gemm_nr, nc - s * gemm_nr), kc, packed_b.data() + s * kc * gemm_nr);
+        };
+
+        auto multiply = [&](size_t begin, size_t end)
+        {
+          std::vector<double> packed_a(kc * ((mc + gemm_mr - 1) / gemm_mr * gemm_mr));
+          for (size_t block = begin; block < end; block++)
+          {
+            const size_t ic = block * mc;
+            const size_t rows = std::min(mc, m - ic);
+
+            for (size_t ir = 0; ir < rows; ir += gemm_mr)
+              gemm_pack_a(op_a, ic + ir, pc, std::min(gemm_mr, rows - ir), kc, packed_a.data() + ir * kc);
+
+            for (size_t s = 0; s < num_slivers; s++)
+            {
+              const size_t jr = s * gemm_nr;
+              for (size_t ir = 0; ir < rows; ir += gemm_mr)
+              {
+                gemm_micro_kernel(kc, packed_a.data() + ir * kc, packed_b.data() + s * kc * gemm_nr, alpha, beta_pass,
+                                  c->data + (ic + ir) * c->tda + jc + jr, c->tda,
+                                  std::min(gemm_mr, rows - ir), std::min(gemm_nr, nc - jr));
+              }
+            }
+          }
+        };
+
+        if (parallel)
+        {
+          pool.parallel_for(num_slivers, pack_b);
+          pool.parallel_for(num_row_blocks, multiply);
+        }
+        else
+        {
+          pack_b(0, num_slivers);
+          multiply(0, num_row_blocks);
+        }
+      }
+    }
+  }
+
+  // GEMM used by the wrapper: the linked CBLAS when the build found an
+  // optimized one, the built-in blocked kernel otherwise
+  inline auto dgemm(CBLAS_TRANSPOSE_t trans_a, CBLAS_TRANSPOSE_t trans_b, double alpha,
+                    const gsl_matrix *a, const gsl_matrix *b, double beta, gsl_matrix *c) -> void
+  {
+#ifdef GSL_WRAPPER_HAVE_OPTIMIZED_BLAS
+    gsl_blas_dgemm(trans_a, trans_b, alpha, a, b, beta, c);
+#else
+    blocked_gemm(trans_a, trans_b, alpha, a, b, beta, c);
+#endif
+  }
+}
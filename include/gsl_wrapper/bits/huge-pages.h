@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+
+#include "thread-pool.h"
+
+namespace gsl_wrapper::bits
+{
+  // Transparent huge pages are 2 MiB on the platforms that support them
+  constexpr size_t huge_page_size = size_t{2} << 20;
+
+  // Maps `bytes` of memory aligned to a huge page and asks for huge page backing
+  inline auto map_huge_pages(size_t bytes) -> std::shared_ptr<double>
+  {
+#if defined(__unix__) || defined(__APPLE__)
+    const size_t length = (bytes + huge_page_size - 1) / huge_page_size * huge_page_size;
+
+    // Over-mapping by one huge page so the start can be aligned by trimming
+    void *mapping = mmap(nullptr, length + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED)
+      throw std::bad_alloc{};
+
+    const auto address = reinterpret_cast<std::uintptr_t>(mapping);
+    const auto aligned = (address + huge_page_size - 1) / huge_page_size * huge_page_size;
+    const size_t head = aligned - address;
+    if (head != 0)
+      munmap(mapping, head);
+    if (huge_page_size - head != 0)
+      munmap(reinterpret_cast<void *>(aligned + length), huge_page_size - head);
+
+#ifdef MADV_HUGEPAGE
+    madvise(reinterpret_cast<void *>(aligned), length, MADV_HUGEPAGE);
+#endif
+
+    return std::shared_ptr<double>(reinterpret_cast<double *>(aligned), [length](double *data)
+                                   { munmap(data, length); });
+#else
+    void *memory = std::malloc(bytes);
+    if (memory == nullptr)
+      throw std::bad_alloc{};
+    return std::shared_ptr<double>(static_cast<double *>(memory), std::free);
+#endif
+  }
+
+  // Allocates a zeroed num_rows x num_collumns array on huge pages, zeroing
+  // row blocks on the threads of the pool so the page faults of large
+  // matrices are taken in parallel
+  //
+  // This is no NUMA placement: workers are not pinned and take blocks from a
+  // shared queue, so pages land on whichever node the zeroing thread ran on.
+  inline auto allocate_zeroed_huge_pages(size_t num_rows, size_t num_collumns, ThreadPool &pool) -> std::shared_ptr<double>
+  {
+    auto storage = map_huge_pages(num_rows * num_collumns * sizeof(double));
+    double *data = storage.get();
+
+    pool.parallel_for(num_rows, [data, num_collumns](size_t begin, size_t end)
+                      { std::memset(data + begin * num_collumns, 0, (end - begin) * num_collumns * sizeof(double)); });
+
+    return storage;
+  }
+}
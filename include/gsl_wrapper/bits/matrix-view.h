@@ -13,6 +13,11 @@ namespace gsl_wrapper::bits
     // Consructor
     MatrixRow(gsl_vector_view view);
 
+    // Member functions
+    auto size() const -> size_t;
+    auto data() -> double *;
+    auto data() const -> const double *;
+
     // Operators
     operator ::gsl_wrapper::Vector() const;
 
@@ -23,16 +28,53 @@ namespace gsl_wrapper::bits
     gsl_vector_view m_view;
   };
 
+  // Row of a const Matrix, copies of it stay read-only. Copy on write shares
+  // the storage of const matrices, so a writable copy would reach them all.
+  class ConstMatrixRow
+  {
+  public:
+    // Consructor
+    ConstMatrixRow(gsl_vector_const_view view);
+
+    // Member functions
+    auto size() const -> size_t;
+    auto data() const -> const double *;
+
+    // Operators
+    operator ::gsl_wrapper::Vector() const;
+
+    auto operator[](const size_t index) const -> const double &;
+
+  private:
+    gsl_vector_const_view m_view;
+  };
+
   inline MatrixRow::MatrixRow(gsl_vector_view view)
       : m_view{view}
   {
   }
 
+  inline auto MatrixRow::size() const -> size_t
+  {
+    return m_view.vector.size;
+  }
+
+  // Rows of a gsl_matrix are contiguous
+  inline auto MatrixRow::data() -> double *
+  {
+    return m_view.vector.data;
+  }
+
+  inline auto MatrixRow::data() const -> const double *
+  {
+    return m_view.vector.data;
+  }
+
   inline MatrixRow::operator ::gsl_wrapper::Vector() const
   {
-    auto space = gsl_vector_calloc(m_view.vector.size);
-    gsl_vector_memcpy(space, &m_view.vector);
-    return ::gsl_wrapper::Vector(space);
+    ::gsl_wrapper::Vector result(m_view.vector.size);
+    gsl_vector_memcpy(result.get_gsl_vector(), &m_view.vector);
+    return result;
   }
 
   inline auto MatrixRow::operator[](const size_t index) -> double &
@@ -45,4 +87,31 @@ namespace gsl_wrapper::bits
     return *gsl_vector_const_ptr(&m_view.vector, index);
   }
 
+  inline ConstMatrixRow::ConstMatrixRow(gsl_vector_const_view view)
+      : m_view{view}
+  {
+  }
+
+  inline auto ConstMatrixRow::size() const -> size_t
+  {
+    return m_view.vector.size;
+  }
+
+  inline auto ConstMatrixRow::data() const -> const double *
+  {
+    return m_view.vector.data;
+  }
+
+  inline ConstMatrixRow::operator ::gsl_wrapper::Vector() const
+  {
+    ::gsl_wrapper::Vector result(m_view.vector.size);
+    gsl_vector_memcpy(result.get_gsl_vector(), &m_view.vector);
+    return result;
+  }
+
+  inline auto ConstMatrixRow::operator[](const size_t index) const -> const double &
+  {
+    return *gsl_vector_const_ptr(&m_view.vector, index);
+  }
+
 }
\ No newline at end of file
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include <gsl/gsl_math.h>
+
+#include "thread-pool.h"
+
+namespace gsl_wrapper::bits
+{
+  // Philox4x32-10 counter based generator (Salmon et al., SC'11)
+  //
+  // Every 128 bit counter is encrypted independently under the 64 bit key,
+  // so element i of a fill depends only on the seed and i. Splitting a fill
+  // between any number of threads gives the same values.
+  constexpr std::uint32_t philox_multiplier_0 = 0xD2511F53;
+  constexpr std::uint32_t philox_multiplier_1 = 0xCD9E8D57;
+  constexpr std::uint32_t philox_weyl_0 = 0x9E3779B9;
+  constexpr std::uint32_t philox_weyl_1 = 0xBB67AE85;
+  constexpr size_t philox_rounds = 10;
+
+  // Counters encrypted together, the rounds run across them in SIMD lanes
+  constexpr size_t philox_block = 64;
+
+  // Fills with fewer elements than this stay on the calling thread
+  constexpr size_t random_parallel_threshold = size_t{1} << 15;
+
+  // Distinguishes the fills, so one seed gives unrelated values for each
+  enum class RandomDistribution : std::uint32_t
+  {
+    Uniform = 1,
+    Gaussian,
+    Exponential,
+    Lognormal
+  };
+
+  // Encrypts `count` counters in place, word w of counter i is x[w][i]
+  inline auto philox_rounds_block(std::uint64_t key, size_t count, std::uint32_t (&x)[4][philox_block]) -> void
+  {
+    std::uint32_t key_0 = static_cast<std::uint32_t>(key);
+    std::uint32_t key_1 = static_cast<std::uint32_t>(key >> 32);
+
+    for (size_t round = 0; round < philox_rounds; round++)
+    {
+      for (size_t i = 0; i < count; i++)
+      {
+        const std::uint64_t product_0 = std::uint64_t{philox_multiplier_0} * x[0][i];
+        const std::uint64_t product_1 = std::uint64_t{philox_multiplier_1} * x[2][i];
+        const std::uint32_t next_0 = static_cast<std::uint32_t>(product_1 >> 32) ^ x[1][i] ^ key_0;
+        const std::uint32_t next_2 = static_cast<std::uint32_t>(product_0 >> 32) ^ x[3][i] ^ key_1;
+        x[0][i] = next_0;
+        x[1][i] = static_cast<std::uint32_t>(product_1);
+        x[2][i] = next_2;
+        x[3][i] = static_cast<std::uint32_t>(product_0);
+      }
+      key_0 += philox_weyl_0;
+      key_1 += philox_weyl_1;
+    }
+  }
+
+  // 53 random bits mapped to the open interval (0, 1)
+  inline auto unit_interval(std::uint32_t high, std::uint32_t low) -> double
+  {
+    const std::uint64_t bits = ((std::uint64_t{high} << 32) | low) >> 11;
+    return (static_cast<double>(bits) + 0.5) * 0x1.0p-53;
+  }
+
+  // Writes elements [begin, end) of the random sequence to out[0], out[stride], ...
+  //
+  // Element pair (2 m, 2 m + 1) comes from counter (m, distribution), whose
+  // two uniforms the transform turns into the two values of the pair.
+  template <typename PairTransform>
+  inline auto random_fill(std::uint64_t seed, RandomDistribution distribution, size_t begin, size_t end,
+                          double *out, size_t stride, PairTransform transform) -> void
+  {
+    std::uint32_t x[4][philox_block];
+    double first[philox_block];
+    double second[philox_block];
+
+    const size_t pair_end = (end + 1) / 2;
+    for (size_t pair = begin / 2; pair < pair_end; pair += philox_block)
+    {
+      const size_t count = std::min(philox_block, pair_end - pair);
+      for (size_t i = 0; i < count; i++)
+      {
+        const std::uint64_t counter = pair + i;
+        x[0][i] = static_cast<std::uint32_t>(counter);
+        x[1][i] = static_cast<std::uint32_t>(counter >> 32);
+        x[2][i] = static_cast<std::uint32_t>(distribution);
+        x[3][i] = 0;
+      }
+
+      philox_rounds_block(seed, count, x);
+
+      for (size_t i = 0; i < count; i++)
+      {
+        first[i] = unit_interval(x[0][i], x[1][i]);
+        second[i] = unit_interval(x[2][i], x[3][i]);
+      }
+      for (size_t i = 0; i < count; i++)
+        transform(first[i], second[i]);
+
+      // The first and last pair may be only half inside the range
+      for (size_t i = 0; i < count; i++)
+      {
+        const size_t element = 2 * (pair + i);
+        if (element >= begin && element < end)
+          out[(element - begin) * stride] = first[i];
+        if (element + 1 >= begin && element + 1 < end)
+          out[(element + 1 - begin) * stride] = second[i];
+      }
+    }
+  }
+
+  // Pair transforms taking two uniforms in (0, 1) to two samples in place
+  inline auto uniform_pair(double lower, double upper)
+  {
+    return [lower, upper](double &u0, double &u1)
+    {
+      u0 = lower + (upper - lower) * u0;
+      u1 = lower + (upper - lower) * u1;
+    };
+  }
+
+  // Box-Muller transform
+  inline auto gaussian_pair(double mean, double sigma)
+  {
+    return [mean, sigma](double &u0, double &u1)
+    {
+      const double radius = sigma * std::sqrt(-2.0 * std::log(u0));
+      const double angle = 2.0 * M_PI * u1;
+      u0 = mean + radius * std::cos(angle);
+      u1 = mean + radius * std::sin(angle);
+    };
+  }
+
+  inline auto exponential_pair(double mean)
+  {
+    return [mean](double &u0, double &u1)
+    {
+      u0 = -mean * std::log(u0);
+      u1 = -mean * std::log(u1);
+    };
+  }
+
+  // exp of a gaussian with the given mean and sigma
+  inline auto lognormal_pair(double zeta, double sigma)
+  {
+    return [gaussian = gaussian_pair(zeta, sigma)](double &u0, double &u1)
+    {
+      gaussian(u0, u1);
+      u0 = std::exp(u0);
+      u1 = std::exp(u1);
+    };
+  }
+
+  // Fills num_rows rows of num_collumns values, row i starting at
+  // data + i * row_stride, with element (i, j) taking sequence index
+  // i * num_collumns + j. Large fills split the rows between the threads of
+  // the shared pool.
+  template <typename PairTransform>
+  inline auto random_fill_rows(std::uint64_t seed, RandomDistribution distribution, size_t num_rows, size_t num_collumns,
+                               double *data, size_t row_stride, size_t collumn_stride, PairTransform transform) -> void
+  {
+    auto body = [=](size_t begin, size_t end)
+    {
+      if (row_stride == num_collumns * collumn_stride)
+      {
+        random_fill(seed, distribution, begin * num_collumns, end * num_collumns, data + begin * row_stride, collumn_stride, transform);
+        return;
+      }
+      for (size_t i = begin; i < end; i++)
+        random_fill(seed, distribution, i * num_collumns, (i + 1) * num_collumns, data + i * row_stride, collumn_stride, transform);
+    };
+
+    if (num_rows * num_collumns < random_parallel_threshold)
+    {
+      body(0, num_rows);
+      return;
+    }
+    ThreadPool::shared().parallel_for(num_rows, body);
+  }
+}
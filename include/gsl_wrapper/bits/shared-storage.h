@@ -0,0 +1,25 @@
+#pragma once
+
+#include <memory>
+#include <new>
+
+#include <gsl/gsl_block.h>
+
+namespace gsl_wrapper::bits
+{
+  // Reference counted ownership of a gsl_block, pointing at `data` inside it
+  inline auto adopt_block(gsl_block *block, double *data) -> std::shared_ptr<double>
+  {
+    return std::shared_ptr<double>(data, [block](double *)
+                                   { gsl_block_free(block); });
+  }
+
+  // Reference counted storage for `size` doubles, allocated through GSL
+  inline auto allocate_block(size_t size) -> std::shared_ptr<double>
+  {
+    gsl_block *block = gsl_block_alloc(size > 0 ? size : 1);
+    if (block == nullptr)
+      throw std::bad_alloc{};
+    return adopt_block(block, block->data);
+  }
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace gsl_wrapper::bits
+{
+  // Fixed set of worker threads executing submitted tasks in FIFO order
+  class ThreadPool
+  {
+  public:
+    // Constructors and destructor
+    ThreadPool(size_t num_threads = 0);
+
+    ThreadPool(const ThreadPool &copy_from) = delete;
+    ThreadPool(ThreadPool &&move_from) = delete;
+
+    ~ThreadPool();
+
+    // Member functions
+    auto submit(std::function<void()> task) -> void;
+    auto size() const -> size_t;
+
+    // Runs body(begin, end) on contiguous blocks of [0, count) and waits for them
+    auto parallel_for(size_t count, const std::function<void(size_t, size_t)> &body) -> void;
+
+    // Runs one queued task on the calling thread, false when none is queued.
+    // Threads waiting on pool work call it so waits inside tasks can't deadlock.
+    auto run_pending_task() -> bool;
+
+    // Block of [0, count) handled by part `index` out of `num_parts`
+    static auto partition(size_t count, size_t num_parts, size_t index) -> std::pair<size_t, size_t>;
+
+    // Pool shared by every component of the wrapper
+    static auto shared() -> ThreadPool &;
+
+    // Operators
+    auto operator=(const ThreadPool &copy_from) -> ThreadPool & = delete;
+    auto operator=(ThreadPool &&move_from) -> ThreadPool & = delete;
+
+  private:
+    auto worker_loop() -> void;
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping;
+  };
+
+  inline ThreadPool::ThreadPool(size_t num_threads)
+      : m_stopping{false}
+  {
+    if (num_threads == 0)
+      num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    m_workers.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; i++)
+    {
+      m_workers.emplace_back([this]
+                             { worker_loop(); });
+    }
+  }
+
+  inline ThreadPool::~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      m_stopping = true;
+    }
+    m_condition.notify_all();
+
+    for (auto &&worker : m_workers)
+    {
+      worker.join();
+    }
+  }
+
+  inline auto ThreadPool::submit(std::function<void()> task) -> void
+  {
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      m_tasks.push_back(std::move(task));
+    }
+    m_condition.notify_one();
+  }
+
+  inline auto ThreadPool::size() const -> size_t
+  {
+    return m_workers.size();
+  }
+
+  inline auto ThreadPool::parallel_for(size_t count, const std::function<void(size_t, size_t)> &body) -> void
+  {
+    const size_t num_parts = std::min(count, m_workers.size());
+    if (num_parts <= 1)
+    {
+      body(0, count);
+      return;
+    }
+
+    struct Progress
+    {
+      std::mutex mutex;
+      std::condition_variable finished;
+      size_t remaining;
+      std::exception_ptr error;
+    };
+    auto progress = std::make_shared<Progress>();
+    progress->remaining = num_parts;
+
+    auto run_part = [progress, &body, count, num_parts](size_t index)
+    {
+      auto [begin, end] = partition(count, num_parts, index);
+      try
+      {
+        body(begin, end);
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock{progress->mutex};
+        if (!progress->error)
+          progress->error = std::current_exception();
+      }
+
+      std::lock_guard<std::mutex> lock{progress->mutex};
+      if (--progress->remaining == 0)
+        progress->finished.notify_all();
+    };
+
+    for (size_t index = 1; index < num_parts; index++)
+    {
+      submit([run_part, index]
+             { run_part(index); });
+    }
+    run_part(0);
+
+    // Helping with queued work keeps nested calls from worker threads from deadlocking
+    while (true)
+    {
+      {
+        std::lock_guard<std::mutex> lock{progress->mutex};
+        if (progress->remaining == 0)
+          break;
+      }
+      if (!run_pending_task())
+      {
+        std::unique_lock<std::mutex> lock{progress->mutex};
+        progress->finished.wait(lock, [&progress]
+                                { return progress->remaining == 0; });
+        break;
+      }
+    }
+
+    if (progress->error)
+      std::rethrow_exception(progress->error);
+  }
+
+  inline auto ThreadPool::partition(size_t count, size_t num_parts, size_t index) -> std::pair<size_t, size_t>
+  {
+    const size_t base = count / num_parts;
+    const size_t extra = count % num_parts;
+
+    const size_t begin = index * base + std::min(index, extra);
+    return {begin, begin + base + (index < extra ? 1 : 0)};
+  }
+
+  inline auto ThreadPool::shared() -> ThreadPool &
+  {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  inline auto ThreadPool::worker_loop() -> void
+  {
+    while (true)
+    {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_condition.wait(lock, [this]
+                         { return m_stopping || !m_tasks.empty(); });
+
+        // Remaining tasks are drained before the workers exit
+        if (m_tasks.empty())
+          return;
+
+        task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+  inline auto ThreadPool::run_pending_task() -> bool
+  {
+    std::function<void()> task;
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      if (m_tasks.empty())
+        return false;
+
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+    task();
+    return true;
+  }
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+namespace gsl_wrapper::bits
+{
+  // Per thread pool of GSL workspaces of one type keyed by the size they were
+  // allocated for
+  //
+  // Alloc and Free are the matching gsl_*_alloc and gsl_*_free functions.
+  // A lease hands its workspace back to the pool of the thread releasing it,
+  // which keeps at most max_idle of them per size and frees the rest. Idle
+  // workspaces of at most max_sizes sizes are kept, a new size frees those
+  // of another one. Every pool is registered, so clear() reaches the pools
+  // of the thread pool's workers as well as the calling thread's.
+  template <typename Workspace, Workspace *(*Alloc)(size_t), void (*Free)(Workspace *)>
+  class WorkspaceCache
+  {
+  public:
+    static constexpr size_t max_idle = 4;
+    static constexpr size_t max_sizes = 16;
+
+    class Release
+    {
+    public:
+      Release(size_t size = 0);
+      auto operator()(Workspace *workspace) const -> void;
+
+    private:
+      size_t m_size;
+    };
+
+    using Lease = std::unique_ptr<Workspace, Release>;
+
+    // Member functions
+    static auto acquire(size_t size) -> Lease;
+    static auto idle_count(size_t size) -> size_t;
+    static auto clear() -> void;
+
+  private:
+    struct Pool
+    {
+      // Only contended by clear() running on another thread
+      std::mutex mutex;
+      std::unordered_map<size_t, std::vector<Workspace *>> idle;
+
+      Pool();
+      ~Pool();
+
+      auto free_all() -> void;
+    };
+
+    struct Registry
+    {
+      std::mutex mutex;
+      std::vector<Pool *> pools;
+    };
+
+    static auto pool() -> Pool &;
+    static auto registry() -> Registry &;
+  };
+
+  template <typename Workspace, Workspace *(*Alloc)(size_t), void (*Free)(Workspace *)>
+  inline WorkspaceCache<Workspace, Alloc, Free>::Release::Release(size_t size)
+      : m_size{size}
+  {
+  }
+
+  template <typename Workspace, Workspace *(*Alloc)(size_t), void (*Free)(Workspace *)>
+  inline auto WorkspaceCache<Workspace, Alloc, Free>::Release::operator()(Workspace *workspace) const -> void
+  {
+    Pool &local = pool();
+    std::lock_guard<std::mutex> lock{local.mutex};
+    auto &idle = local.idle;
+    auto found = idle.find(m_size);
+    if (found == idle.end())
+    {
+      if (idle.size() >= max_sizes)
+      {
+        for (Workspace *other : idle.begin()->second)
+          Free(other);
+        idle.erase(idle.begin());
+      }
+      found = idle.emplace(m_size, std::vector<Workspace *>{}).first;
+    }
+
+    if (found->second.size() >= max_idle)
+    {
+      Free(workspace);
+      return;
+    }
+    found->second.push_back(workspace);
+  }
+
+  template <typename Workspace, Workspace *(*Alloc)(size_t), void (*Free)(Workspace *)>
+  inline auto WorkspaceCache<Workspace, Alloc, Free>::acquire(size_t size) -> Lease
+  {
+    // Sizes without idle workspaces are dropped, so only cached ones count
+    {
+      Pool &local = pool();
+      std::lock_guard<std::mutex> lock{local.mutex};
+      auto &idle = local.idle;
+      auto found = idle.find(size);
+      if (found != idle.end())
+      {
+        Workspace *workspace = found->second.back();
+        found->second.pop_back();
+        if (found->second.empty())
+          idle.erase(found);
+        return Lease{workspace, Release{size}};
+      }
+    }
+
+    Workspace *workspace = Alloc(size);
+    if (workspace == nullptr)
+      throw std::bad_alloc{};
+    return Lease{workspace, Release{size}};
+  }
+
+  template <typename Workspace, Workspace *(*Alloc)(size_t), void (*Free)(Workspace *)>
+  inline auto WorkspaceCache<Workspace, Alloc, Free>::idle_count(size_t size) -> size_t
+  {
+    Pool &local = pool();
+    std::lock_guard<std::mutex> lock{local.mutex};
+    auto found = local.idle.find(size);
+    return found == local.idle.end() ? 0 : found->second.size();
+  }
+
+  // Frees the idle workspaces of every thread, leases still out are
+  // unaffected and return to their thread's pool as usual
+  template <typename Workspace, Workspace *(*Alloc)(size_t), void (*Free)(Workspace *)>
+  inline auto WorkspaceCache<Workspace, Alloc, Free>::clear() -> void
+  {
+    Registry &shared = registry();
+    std::lock_guard<std::mutex> lock{shared.mutex};
+    for (Pool *other : shared.pools)
+    {
+      std::lock_guard<std::mutex> pool_lock{other->mutex};
+      other->free_all();
+    }
+  }
+
+  template <typename Workspace, Workspace *(*Alloc)(size_t), void (*Free)(Workspace *)>
+  inline WorkspaceCache<Workspace, Alloc, Free>::Pool::Pool()
+  {
+    Registry &shared = registry();
+    std::lock_guard<std::mutex> lock{shared.mutex};
+    shared.pools.push_back(this);
+  }
+
+  template <typename Workspace, Workspace *(*Alloc)(size_t), void (*Free)(Workspace *)>
+  inline WorkspaceCache<Workspace, Alloc, Free>::Pool::~Pool()
+  {
+    {
+      Registry &shared = registry();
+      std::lock_guard<std::mutex> lock{shared.mutex};
+      shared.pools.erase(std::find(shared.pools.begin(), shared.pools.end(), this));
+    }
+    free_all();
+  }
+
+  template <typename Workspace, Workspace *(*Alloc)(size_t), void (*Free)(Workspace *)>
+  inline auto WorkspaceCache<Workspace, Alloc, Free>::Pool::free_all() -> void
+  {
+    for (auto &[size, workspaces] : idle)
+    {
+      for (Workspace *workspace : workspaces)
+        Free(workspace);
+    }
+    idle.clear();
+  }
+
+  template <typename Workspace, Workspace *(*Alloc)(size_t), void (*Free)(Workspace *)>
+  inline auto WorkspaceCache<Workspace, Alloc, Free>::pool() -> Pool &
+  {
+    thread_local Pool instance;
+    return instance;
+  }
+
+  // Never destroyed, the workers of the static shared thread pool unregister
+  // their pools during static destruction
+  template <typename Workspace, Workspace *(*Alloc)(size_t), void (*Free)(Workspace *)>
+  inline auto WorkspaceCache<Workspace, Alloc, Free>::registry() -> Registry &
+  {
+    static Registry *instance = new Registry;
+    return *instance;
+  }
+}
@@ -0,0 +1,565 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <gsl/gsl_blas.h>
+#include <gsl/gsl_matrix.h>
+
+#include "bits/gemm.h"
+#include "bits/thread-pool.h"
+#include "matrix.h"
+#include "vector.h"
+
+namespace gsl_wrapper::deferred
+{
+  class Graph;
+
+  // Handle to a not yet computed value recorded in a Graph
+  class Expression
+  {
+  public:
+    // Member functions
+    auto evaluate() const -> const Matrix &;
+    auto get_dimensions() const -> std::pair<size_t, size_t>;
+
+    // Operators
+    operator Matrix() const;
+
+    auto operator*(const Expression &mul) const -> Expression;
+    auto operator*(const double number) const -> Expression;
+    auto operator+(const Expression &add) const -> Expression;
+    auto operator+(const double number) const -> Expression;
+
+    // Friend declarations
+    friend auto operator*(const double number, const Expression &expression) -> Expression;
+    friend auto operator+(const double number, const Expression &expression) -> Expression;
+    friend class Graph;
+
+  private:
+    Expression(Graph *graph, size_t id);
+
+    Graph *m_graph;
+    size_t m_id;
+  };
+
+  // Records Matrix operations as a DAG and computes them on a thread pool
+  //
+  // Identical subexpressions are recorded once, independent nodes run
+  // concurrently and intermediate buffers are recycled as soon as their last
+  // consumer has finished. Inputs are copied when they are entered, so later
+  // changes to the matrix do not reach the graph. Entering equal contents
+  // twice gives the same node.
+  class Graph
+  {
+  public:
+    // Constructors and destructor
+    Graph(bits::ThreadPool &pool = bits::ThreadPool::shared());
+
+    Graph(const Graph &copy_from) = delete;
+    Graph(Graph &&move_from) = delete;
+
+    // Member functions
+    auto input(const Matrix &matrix) -> Expression;
+    auto input(const Vector &vector) -> Expression;
+
+    auto evaluate(const Expression &expression) -> const Matrix &;
+    auto evaluate(const std::vector<Expression> &expressions) -> void;
+
+    auto num_nodes() const -> size_t;
+
+    // Operators
+    auto operator=(const Graph &copy_from) -> Graph & = delete;
+    auto operator=(Graph &&move_from) -> Graph & = delete;
+
+    // Friend declarations
+    friend class Expression;
+
+  private:
+    enum class Operation
+    {
+      Input,
+      Product,
+      Sum,
+      Scale,
+      Shift
+    };
+
+    struct Node
+    {
+      Operation operation;
+      size_t lhs;
+      size_t rhs;
+      double number;
+      size_t num_rows;
+      size_t num_collumns;
+    };
+
+    // Bookkeeping of a single evaluate() call
+    struct Evaluation
+    {
+      std::vector<bool> needed;
+      std::vector<bool> is_target;
+      std::vector<size_t> pending;
+      std::vector<size_t> consumers;
+      std::vector<std::vector<size_t>> dependents;
+      std::vector<std::unique_ptr<Matrix>> buffers;
+      size_t remaining;
+      // Bumped whenever nodes are submitted, wakes evaluate() to help run them
+      size_t submitted = 0;
+      std::exception_ptr error;
+      std::mutex mutex;
+      std::condition_variable finished;
+    };
+
+    using NodeKey = std::tuple<Operation, size_t, size_t, std::uint64_t>;
+
+    auto add_node(const Node &node, const NodeKey &key) -> Expression;
+    auto add_input(std::unique_ptr<Matrix> value) -> Expression;
+    auto binary(Operation operation, const Expression &lhs, const Expression &rhs) -> Expression;
+    auto with_number(Operation operation, const Expression &operand, double number) -> Expression;
+
+    auto run_node(std::shared_ptr<Evaluation> state, size_t id) -> void;
+    auto operand(size_t id, const std::vector<std::unique_ptr<Matrix>> &buffers) const -> const gsl_matrix *;
+    auto acquire_buffer(size_t num_rows, size_t num_collumns) -> std::unique_ptr<Matrix>;
+    auto release_buffer(std::unique_ptr<Matrix> buffer) -> void;
+
+    static auto operands(const Node &node) -> std::vector<size_t>;
+    static auto compute(const Node &node, const gsl_matrix *lhs, const gsl_matrix *rhs, gsl_matrix *result) -> void;
+    static auto number_key(double number) -> std::uint64_t;
+    static auto content_key(const gsl_matrix *matrix) -> std::uint64_t;
+
+    bits::ThreadPool &m_pool;
+    std::vector<Node> m_nodes;
+    std::map<NodeKey, size_t> m_known_nodes;
+    std::map<size_t, std::unique_ptr<Matrix>> m_values;
+    std::multimap<std::pair<size_t, size_t>, std::unique_ptr<Matrix>> m_free_buffers;
+  };
+
+  inline Expression::Expression(Graph *graph, size_t id)
+      : m_graph{graph}, m_id{id}
+  {
+  }
+
+  inline auto Expression::evaluate() const -> const Matrix &
+  {
+    return m_graph->evaluate(*this);
+  }
+
+  inline auto Expression::get_dimensions() const -> std::pair<size_t, size_t>
+  {
+    const auto &node = m_graph->m_nodes[m_id];
+    return {node.num_rows, node.num_collumns};
+  }
+
+  inline Expression::operator Matrix() const
+  {
+    return evaluate();
+  }
+
+  inline auto Expression::operator*(const Expression &mul) const -> Expression
+  {
+    return m_graph->binary(Graph::Operation::Product, *this, mul);
+  }
+
+  inline auto Expression::operator*(const double number) const -> Expression
+  {
+    return m_graph->with_number(Graph::Operation::Scale, *this, number);
+  }
+
+  inline auto Expression::operator+(const Expression &add) const -> Expression
+  {
+    return m_graph->binary(Graph::Operation::Sum, *this, add);
+  }
+
+  inline auto Expression::operator+(const double number) const -> Expression
+  {
+    return m_graph->with_number(Graph::Operation::Shift, *this, number);
+  }
+
+  inline auto operator*(const double number, const Expression &expression) -> Expression
+  {
+    return expression * number;
+  }
+
+  inline auto operator+(const double number, const Expression &expression) -> Expression
+  {
+    return expression + number;
+  }
+
+  inline Graph::Graph(bits::ThreadPool &pool)
+      : m_pool{pool}
+  {
+  }
+
+  inline auto Graph::input(const Matrix &matrix) -> Expression
+  {
+    const gsl_matrix *source = matrix.get_gsl_matrix();
+    auto value = std::make_unique<Matrix>(source->size1, source->size2);
+    gsl_matrix_memcpy(value->get_gsl_matrix(), source);
+    return add_input(std::move(value));
+  }
+
+  inline auto Graph::input(const Vector &vector) -> Expression
+  {
+    // Vectors enter the graph as column matrices
+    const gsl_vector *source = vector.get_gsl_vector();
+    auto value = std::make_unique<Matrix>(source->size, 1);
+    gsl_matrix *column = value->get_gsl_matrix();
+    for (size_t i = 0; i < source->size; i++)
+      column->data[i * column->tda] = source->data[i * source->stride];
+    return add_input(std::move(value));
+  }
+
+  inline auto Graph::evaluate(const Expression &expression) -> const Matrix &
+  {
+    if (expression.m_graph != this)
+      throw std::runtime_error{"Evaluating expression of a diffrent graph"};
+
+    evaluate(std::vector<Expression>{expression});
+    return *m_values.at(expression.m_id);
+  }
+
+  inline auto Graph::evaluate(const std::vector<Expression> &expressions) -> void
+  {
+    const size_t num_nodes = m_nodes.size();
+    auto has_value = [this](size_t id)
+    { return m_values.count(id) != 0; };
+
+    // Finding every node that still has to be computed
+    std::vector<bool> needed(num_nodes, false);
+    std::vector<bool> is_target(num_nodes, false);
+    std::vector<size_t> stack;
+    for (auto &&expression : expressions)
+    {
+      if (expression.m_graph != this)
+        throw std::runtime_error{"Evaluating expression of a diffrent graph"};
+
+      if (has_value(expression.m_id))
+        continue;
+      is_target[expression.m_id] = true;
+      stack.push_back(expression.m_id);
+    }
+
+    while (!stack.empty())
+    {
+      size_t id = stack.back();
+      stack.pop_back();
+      if (needed[id])
+        continue;
+      needed[id] = true;
+
+      for (size_t dependency : operands(m_nodes[id]))
+      {
+        if (!has_value(dependency))
+          stack.push_back(dependency);
+      }
+    }
+
+    // Dependency counts and consumer counts for buffer lifetimes
+    std::vector<size_t> pending(num_nodes, 0);
+    std::vector<size_t> consumers(num_nodes, 0);
+    std::vector<std::vector<size_t>> dependents(num_nodes);
+    std::vector<size_t> ready;
+    size_t remaining = 0;
+
+    for (size_t id = 0; id < num_nodes; id++)
+    {
+      if (!needed[id])
+        continue;
+      ++remaining;
+
+      for (size_t dependency : operands(m_nodes[id]))
+      {
+        if (needed[dependency])
+        {
+          ++pending[id];
+          ++consumers[dependency];
+          dependents[dependency].push_back(id);
+        }
+      }
+
+      if (pending[id] == 0)
+        ready.push_back(id);
+    }
+
+    if (remaining == 0)
+      return;
+
+    // Tasks share the evaluation state, so it outlives the last of them
+    auto state = std::make_shared<Evaluation>();
+    state->needed = std::move(needed);
+    state->is_target = std::move(is_target);
+    state->pending = std::move(pending);
+    state->consumers = std::move(consumers);
+    state->dependents = std::move(dependents);
+    state->buffers.resize(num_nodes);
+    state->remaining = remaining;
+
+    for (size_t id : ready)
+    {
+      m_pool.submit([this, state, id]
+                    { run_node(state, id); });
+    }
+
+    // Helping with queued work keeps evaluate() from deadlocking when it is
+    // called from a worker of the same pool
+    while (true)
+    {
+      size_t submitted;
+      {
+        std::lock_guard<std::mutex> lock{state->mutex};
+        if (state->remaining == 0)
+          break;
+        submitted = state->submitted;
+      }
+      if (!m_pool.run_pending_task())
+      {
+        std::unique_lock<std::mutex> lock{state->mutex};
+        state->finished.wait(lock, [&state, submitted]
+                             { return state->remaining == 0 || state->submitted != submitted; });
+      }
+    }
+
+    if (state->error)
+      std::rethrow_exception(state->error);
+
+    for (size_t id = 0; id < num_nodes; id++)
+    {
+      if (state->is_target[id])
+        m_values[id] = std::move(state->buffers[id]);
+    }
+  }
+
+  inline auto Graph::run_node(std::shared_ptr<Evaluation> state, size_t id) -> void
+  {
+    const Node &node = m_nodes[id];
+    try
+    {
+      std::unique_ptr<Matrix> result;
+      const gsl_matrix *lhs = nullptr;
+      const gsl_matrix *rhs = nullptr;
+      {
+        std::lock_guard<std::mutex> lock{state->mutex};
+        if (!state->error)
+        {
+          result = acquire_buffer(node.num_rows, node.num_collumns);
+          lhs = operand(node.lhs, state->buffers);
+          rhs = operand(node.rhs, state->buffers);
+        }
+      }
+
+      // Nodes after a failure are only accounted for, not computed
+      if (result)
+      {
+        compute(node, lhs, rhs, result->get_gsl_matrix());
+
+        std::lock_guard<std::mutex> lock{state->mutex};
+        state->buffers[id] = std::move(result);
+      }
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock{state->mutex};
+      if (!state->error)
+        state->error = std::current_exception();
+    }
+
+    std::vector<size_t> now_ready;
+    {
+      std::lock_guard<std::mutex> lock{state->mutex};
+
+      // Intermediates go back to the pool once nothing reads them anymore
+      for (size_t dependency : operands(node))
+      {
+        if (state->needed[dependency] && --state->consumers[dependency] == 0 &&
+            !state->is_target[dependency] && state->buffers[dependency])
+          release_buffer(std::move(state->buffers[dependency]));
+      }
+
+      for (size_t dependent : state->dependents[id])
+      {
+        if (--state->pending[dependent] == 0)
+          now_ready.push_back(dependent);
+      }
+    }
+
+    for (size_t dependent : now_ready)
+    {
+      m_pool.submit([this, state, dependent]
+                    { run_node(state, dependent); });
+    }
+
+    std::lock_guard<std::mutex> lock{state->mutex};
+    if (!now_ready.empty())
+      ++state->submitted;
+    if (--state->remaining == 0 || !now_ready.empty())
+      state->finished.notify_all();
+  }
+
+  inline auto Graph::num_nodes() const -> size_t
+  {
+    return m_nodes.size();
+  }
+
+  inline auto Graph::add_node(const Node &node, const NodeKey &key) -> Expression
+  {
+    // Reusing an already recorded identical subexpression
+    auto found = m_known_nodes.find(key);
+    if (found != m_known_nodes.end())
+      return Expression(this, found->second);
+
+    m_nodes.push_back(node);
+    m_known_nodes.emplace(key, m_nodes.size() - 1);
+    return Expression(this, m_nodes.size() - 1);
+  }
+
+  inline auto Graph::add_input(std::unique_ptr<Matrix> value) -> Expression
+  {
+    const gsl_matrix *copy = value->get_gsl_matrix();
+    const NodeKey key{Operation::Input, copy->size1, copy->size2, content_key(copy)};
+
+    // Inputs are matched by their contents, the hash only narrows it down
+    auto found = m_known_nodes.find(key);
+    if (found != m_known_nodes.end() &&
+        std::memcmp(m_values.at(found->second)->get_gsl_matrix()->data, copy->data, copy->size1 * copy->size2 * sizeof(double)) == 0)
+      return Expression(this, found->second);
+
+    const size_t id = m_nodes.size();
+    m_nodes.push_back(Node{Operation::Input, 0, 0, 0.0, copy->size1, copy->size2});
+    m_known_nodes.emplace(key, id);
+    m_values[id] = std::move(value);
+    return Expression(this, id);
+  }
+
+  inline auto Graph::binary(Operation operation, const Expression &lhs, const Expression &rhs) -> Expression
+  {
+    if (lhs.m_graph != this || rhs.m_graph != this)
+      throw std::runtime_error{"Combining expressions of diffrent graphs"};
+
+    const Node &left = m_nodes[lhs.m_id];
+    const Node &right = m_nodes[rhs.m_id];
+
+    Node node{operation, lhs.m_id, rhs.m_id, 0.0, left.num_rows, left.num_collumns};
+    if (operation == Operation::Product)
+    {
+      if (left.num_collumns != right.num_rows)
+        throw std::runtime_error{"Wrong matrix sizes!"};
+      node.num_collumns = right.num_collumns;
+    }
+    else
+    {
+      if ((left.num_collumns != right.num_collumns) || (left.num_rows != right.num_rows))
+        throw std::range_error{"Wrong matrix sizes when adding"};
+    }
+
+    // Sum is commutative, so both operand orders share a node
+    size_t first = lhs.m_id;
+    size_t second = rhs.m_id;
+    if (operation == Operation::Sum && second < first)
+      std::swap(first, second);
+
+    return add_node(node, {operation, first, second, 0});
+  }
+
+  inline auto Graph::with_number(Operation operation, const Expression &operand, double number) -> Expression
+  {
+    const Node &source = m_nodes[operand.m_id];
+
+    Node node{operation, operand.m_id, operand.m_id, number, source.num_rows, source.num_collumns};
+    return add_node(node, {operation, operand.m_id, operand.m_id, number_key(number)});
+  }
+
+  inline auto Graph::operand(size_t id, const std::vector<std::unique_ptr<Matrix>> &buffers) const -> const gsl_matrix *
+  {
+    auto value = m_values.find(id);
+    if (value != m_values.end())
+      return value->second->get_gsl_matrix();
+
+    return buffers[id]->get_gsl_matrix();
+  }
+
+  inline auto Graph::acquire_buffer(size_t num_rows, size_t num_collumns) -> std::unique_ptr<Matrix>
+  {
+    auto found = m_free_buffers.find({num_rows, num_collumns});
+    if (found == m_free_buffers.end())
+      return std::make_unique<Matrix>(num_rows, num_collumns);
+
+    auto buffer = std::move(found->second);
+    m_free_buffers.erase(found);
+    return buffer;
+  }
+
+  inline auto Graph::release_buffer(std::unique_ptr<Matrix> buffer) -> void
+  {
+    auto dimensions = buffer->get_dimensions();
+    m_free_buffers.emplace(dimensions, std::move(buffer));
+  }
+
+  inline auto Graph::operands(const Node &node) -> std::vector<size_t>
+  {
+    switch (node.operation)
+    {
+    case Operation::Input:
+      return {};
+    case Operation::Scale:
+    case Operation::Shift:
+      return {node.lhs};
+    default:
+      if (node.lhs == node.rhs)
+        return {node.lhs};
+      return {node.lhs, node.rhs};
+    }
+  }
+
+  inline auto Graph::compute(const Node &node, const gsl_matrix *lhs, const gsl_matrix *rhs, gsl_matrix *result) -> void
+  {
+    switch (node.operation)
+    {
+    case Operation::Product:
+      bits::dgemm(CblasNoTrans, CblasNoTrans, 1.0, lhs, rhs, 0.0, result);
+      break;
+    case Operation::Sum:
+      gsl_matrix_memcpy(result, lhs);
+      gsl_matrix_add(result, rhs);
+      break;
+    case Operation::Scale:
+      gsl_matrix_memcpy(result, lhs);
+      gsl_matrix_scale(result, node.number);
+      break;
+    case Operation::Shift:
+      gsl_matrix_memcpy(result, lhs);
+      gsl_matrix_add_constant(result, node.number);
+      break;
+    case Operation::Input:
+      break;
+    }
+  }
+
+  inline auto Graph::number_key(double number) -> std::uint64_t
+  {
+    std::uint64_t bits;
+    std::memcpy(&bits, &number, sizeof(bits));
+    return bits;
+  }
+
+  // FNV-1a over the bit patterns of the elements of a contiguous matrix
+  inline auto Graph::content_key(const gsl_matrix *matrix) -> std::uint64_t
+  {
+    const size_t size = matrix->size1 * matrix->size2;
+
+    std::uint64_t hash = 0xcbf29ce484222325;
+    for (size_t i = 0; i < size; i++)
+      hash = (hash ^ number_key(matrix->data[i])) * 0x100000001b3;
+    return hash;
+  }
+}
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <gsl/gsl_eigen.h>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_matrix_complex_double.h>
+#include <gsl/gsl_sort_vector.h>
+#include <gsl/gsl_vector_complex_double.h>
+
+#include "bits/error-handler.h"
+#include "bits/workspace-cache.h"
+#include "matrix.h"
+#include "vector.h"
+
+namespace gsl_wrapper
+{
+  // Eigenvalues and eigenvectors of a real symmetric matrix
+  //
+  // Eigenvalues come in ascending order with the matching normalized
+  // eigenvectors in the collumns of eigenvectors(). Only the lower triangle
+  // and the diagonal of the input are read. An rvalue input is consumed: its
+  // storage is decomposed without a copy and the argument is left empty,
+  // like any moved from matrix.
+  class SymmetricEigen
+  {
+  public:
+    // Constructors
+    SymmetricEigen(const Matrix &matrix, bool compute_eigenvectors = true);
+    SymmetricEigen(Matrix &&matrix, bool compute_eigenvectors = true);
+
+    // Member functions
+    auto size() const -> size_t;
+    auto eigenvalues() const -> const Vector &;
+    auto eigenvectors() const -> const Matrix &;
+    auto has_eigenvectors() const -> bool;
+
+  private:
+    Vector m_eigenvalues;
+    std::optional<Matrix> m_eigenvectors;
+  };
+
+  // Eigenvalues and eigenvectors of a general real matrix
+  //
+  // Complex results are split into real and imaginary parts. Eigenvalues are
+  // sorted by decreasing magnitude, complex conjugate pairs stay next to each
+  // other, and the normalized eigenvectors are stored in the collumns. An
+  // rvalue input is consumed and left empty, as for SymmetricEigen.
+  class NonsymmetricEigen
+  {
+  public:
+    // Constructors
+    NonsymmetricEigen(const Matrix &matrix, bool compute_eigenvectors = true);
+    NonsymmetricEigen(Matrix &&matrix, bool compute_eigenvectors = true);
+
+    // Member functions
+    auto size() const -> size_t;
+    auto eigenvalues_real() const -> const Vector &;
+    auto eigenvalues_imag() const -> const Vector &;
+    auto eigenvectors_real() const -> const Matrix &;
+    auto eigenvectors_imag() const -> const Matrix &;
+    auto has_eigenvectors() const -> bool;
+    auto is_real() const -> bool;
+
+  private:
+    auto unpack(const gsl_vector_complex *eval, const gsl_matrix_complex *evec) -> void;
+
+    Vector m_eigenvalues_real;
+    Vector m_eigenvalues_imag;
+    std::optional<Matrix> m_eigenvectors_real;
+    std::optional<Matrix> m_eigenvectors_imag;
+  };
+
+  namespace bits
+  {
+    inline auto square_matrix_complex_alloc(size_t size) -> gsl_matrix_complex *
+    {
+      return gsl_matrix_complex_alloc(size, size);
+    }
+
+    using SymmWorkspaces = WorkspaceCache<gsl_eigen_symm_workspace, gsl_eigen_symm_alloc, gsl_eigen_symm_free>;
+    using SymmvWorkspaces = WorkspaceCache<gsl_eigen_symmv_workspace, gsl_eigen_symmv_alloc, gsl_eigen_symmv_free>;
+    using NonsymmWorkspaces = WorkspaceCache<gsl_eigen_nonsymm_workspace, gsl_eigen_nonsymm_alloc, gsl_eigen_nonsymm_free>;
+    using NonsymmvWorkspaces = WorkspaceCache<gsl_eigen_nonsymmv_workspace, gsl_eigen_nonsymmv_alloc, gsl_eigen_nonsymmv_free>;
+    using ComplexVectors = WorkspaceCache<gsl_vector_complex, gsl_vector_complex_alloc, gsl_vector_complex_free>;
+    using ComplexMatrices = WorkspaceCache<gsl_matrix_complex, square_matrix_complex_alloc, gsl_matrix_complex_free>;
+
+    inline auto check_square(const Matrix &matrix) -> size_t
+    {
+      if (matrix.num_rows() == 0 || matrix.num_rows() != matrix.num_collumns())
+        throw std::range_error{"Eigen decomposition needs a non empty square matrix"};
+      return matrix.num_rows();
+    }
+  }
+
+  inline SymmetricEigen::SymmetricEigen(const Matrix &matrix, bool compute_eigenvectors)
+      : SymmetricEigen(Matrix(matrix), compute_eigenvectors)
+  {
+  }
+
+  inline SymmetricEigen::SymmetricEigen(Matrix &&matrix, bool compute_eigenvectors)
+      : m_eigenvalues(bits::check_square(matrix))
+  {
+    const size_t size = matrix.num_rows();
+    Matrix input = std::move(matrix);
+    bits::ErrorHandlerOff errors;
+
+    if (!compute_eigenvectors)
+    {
+      auto workspace = bits::SymmWorkspaces::acquire(size);
+      bits::check_status(gsl_eigen_symm(input.get_gsl_matrix(), m_eigenvalues.get_gsl_vector(), workspace.get()));
+      gsl_sort_vector(m_eigenvalues.get_gsl_vector());
+      return;
+    }
+
+    m_eigenvectors.emplace(size, size);
+    auto workspace = bits::SymmvWorkspaces::acquire(size);
+    bits::check_status(gsl_eigen_symmv(input.get_gsl_matrix(), m_eigenvalues.get_gsl_vector(), m_eigenvectors->get_gsl_matrix(), workspace.get()));
+    gsl_eigen_symmv_sort(m_eigenvalues.get_gsl_vector(), m_eigenvectors->get_gsl_matrix(), GSL_EIGEN_SORT_VAL_ASC);
+  }
+
+  inline auto SymmetricEigen::size() const -> size_t
+  {
+    return m_eigenvalues.size();
+  }
+
+  inline auto SymmetricEigen::eigenvalues() const -> const Vector &
+  {
+    return m_eigenvalues;
+  }
+
+  inline auto SymmetricEigen::eigenvectors() const -> const Matrix &
+  {
+    if (!m_eigenvectors)
+      throw std::runtime_error{"Eigenvectors were not computed"};
+    return *m_eigenvectors;
+  }
+
+  inline auto SymmetricEigen::has_eigenvectors() const -> bool
+  {
+    return m_eigenvectors.has_value();
+  }
+
+  inline NonsymmetricEigen::NonsymmetricEigen(const Matrix &matrix, bool compute_eigenvectors)
+      : NonsymmetricEigen(Matrix(matrix), compute_eigenvectors)
+  {
+  }
+
+  inline NonsymmetricEigen::NonsymmetricEigen(Matrix &&matrix, bool compute_eigenvectors)
+      : m_eigenvalues_real(bits::check_square(matrix)),
+        m_eigenvalues_imag(matrix.num_rows())
+  {
+    const size_t size = matrix.num_rows();
+    Matrix input = std::move(matrix);
+    bits::ErrorHandlerOff errors;
+    auto eval = bits::ComplexVectors::acquire(size);
+
+    if (!compute_eigenvectors)
+    {
+      auto workspace = bits::NonsymmWorkspaces::acquire(size);
+      bits::check_status(gsl_eigen_nonsymm(input.get_gsl_matrix(), eval.get(), workspace.get()));
+      unpack(eval.get(), nullptr);
+      return;
+    }
+
+    auto evec = bits::ComplexMatrices::acquire(size);
+    auto workspace = bits::NonsymmvWorkspaces::acquire(size);
+    bits::check_status(gsl_eigen_nonsymmv(input.get_gsl_matrix(), eval.get(), evec.get(), workspace.get()));
+    m_eigenvectors_real.emplace(size, size);
+    m_eigenvectors_imag.emplace(size, size);
+    unpack(eval.get(), evec.get());
+  }
+
+  // Splits the complex results into the real and imaginary parts, ordered by
+  // decreasing magnitude of the eigenvalues
+  inline auto NonsymmetricEigen::unpack(const gsl_vector_complex *eval, const gsl_matrix_complex *evec) -> void
+  {
+    const size_t size = eval->size;
+    std::vector<double> magnitude(size);
+    for (size_t i = 0; i < size; i++)
+    {
+      const double *z = eval->data + 2 * i * eval->stride;
+      magnitude[i] = std::hypot(z[0], z[1]);
+    }
+
+    std::vector<size_t> order(size);
+    std::iota(order.begin(), order.end(), size_t{0});
+    std::stable_sort(order.begin(), order.end(), [&magnitude](size_t a, size_t b)
+                     { return magnitude[a] > magnitude[b]; });
+
+    for (size_t i = 0; i < size; i++)
+    {
+      const double *z = eval->data + 2 * order[i] * eval->stride;
+      m_eigenvalues_real[i] = z[0];
+      m_eigenvalues_imag[i] = z[1];
+    }
+
+    if (evec == nullptr)
+      return;
+
+    gsl_matrix *real = m_eigenvectors_real->get_gsl_matrix();
+    gsl_matrix *imag = m_eigenvectors_imag->get_gsl_matrix();
+    for (size_t i = 0; i < size; i++)
+    {
+      const double *row = evec->data + 2 * i * evec->tda;
+      double *real_row = real->data + i * real->tda;
+      double *imag_row = imag->data + i * imag->tda;
+      for (size_t j = 0; j < size; j++)
+      {
+        real_row[j] = row[2 * order[j]];
+        imag_row[j] = row[2 * order[j] + 1];
+      }
+    }
+  }
+
+  inline auto NonsymmetricEigen::size() const -> size_t
+  {
+    return m_eigenvalues_real.size();
+  }
+
+  inline auto NonsymmetricEigen::eigenvalues_real() const -> const Vector &
+  {
+    return m_eigenvalues_real;
+  }
+
+  inline auto NonsymmetricEigen::eigenvalues_imag() const -> const Vector &
+  {
+    return m_eigenvalues_imag;
+  }
+
+  inline auto NonsymmetricEigen::eigenvectors_real() const -> const Matrix &
+  {
+    if (!m_eigenvectors_real)
+      throw std::runtime_error{"Eigenvectors were not computed"};
+    return *m_eigenvectors_real;
+  }
+
+  inline auto NonsymmetricEigen::eigenvectors_imag() const -> const Matrix &
+  {
+    if (!m_eigenvectors_imag)
+      throw std::runtime_error{"Eigenvectors were not computed"};
+    return *m_eigenvectors_imag;
+  }
+
+  inline auto NonsymmetricEigen::has_eigenvectors() const -> bool
+  {
+    return m_eigenvectors_real.has_value();
+  }
+
+  inline auto NonsymmetricEigen::is_real() const -> bool
+  {
+    for (double imag : m_eigenvalues_imag)
+    {
+      if (imag != 0.0)
+        return false;
+    }
+    return true;
+  }
+}
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_fft_complex.h>
+#include <gsl/gsl_fft_halfcomplex.h>
+#include <gsl/gsl_fft_real.h>
+
+#include "bits/error-handler.h"
+#include "bits/thread-pool.h"
+#include "bits/workspace-cache.h"
+#include "matrix.h"
+#include "vector.h"
+
+namespace gsl_wrapper
+{
+  // Mixed radix fast Fourier transforms working in place
+  //
+  // Real data of length n transforms to the half-complex format of GSL,
+  // which unpack turns into n complex coefficients. Complex data is stored as
+  // n interleaved (real, imaginary) pairs. Inverse transforms are normalized.
+  //
+  // Wavetables and workspaces are cached per thread and length, so repeated
+  // transforms of one length only pay for their setup once.
+  class FFT
+  {
+  public:
+    enum class Direction
+    {
+      Forward,
+      Inverse
+    };
+
+    // Member functions
+    static auto real(Vector &data, Direction direction = Direction::Forward) -> void;
+    static auto complex(Vector &data, Direction direction = Direction::Forward) -> void;
+
+    // Each row or collumn transformed on its own, rows and collumns are split
+    // between the threads of the shared pool
+    static auto real_rows(Matrix &data, Direction direction = Direction::Forward) -> void;
+    static auto real_collumns(Matrix &data, Direction direction = Direction::Forward) -> void;
+    static auto complex_rows(Matrix &data, Direction direction = Direction::Forward) -> void;
+
+    // Half-complex data of length n to 2 n interleaved complex values
+    static auto unpack(const Vector &halfcomplex) -> Vector;
+    static auto unpack(const Vector &halfcomplex, Vector &complex) -> void;
+    static auto unpack_rows(const Matrix &halfcomplex) -> Matrix;
+
+    // Frees the wavetables and workspaces cached by every thread, the
+    // workers of the shared pool included
+    static auto clear_cache() -> void;
+  };
+
+  namespace bits
+  {
+    // Batches smaller than this many elements stay on the calling thread
+    constexpr size_t fft_parallel_threshold = size_t{1} << 15;
+
+    // Collumns gathered together, so the strided reads use whole cache lines
+    constexpr size_t fft_collumn_block = 8;
+
+    using RealWavetables = WorkspaceCache<gsl_fft_real_wavetable, gsl_fft_real_wavetable_alloc, gsl_fft_real_wavetable_free>;
+    using HalfcomplexWavetables = WorkspaceCache<gsl_fft_halfcomplex_wavetable, gsl_fft_halfcomplex_wavetable_alloc, gsl_fft_halfcomplex_wavetable_free>;
+    using RealWorkspaces = WorkspaceCache<gsl_fft_real_workspace, gsl_fft_real_workspace_alloc, gsl_fft_real_workspace_free>;
+    using ComplexWavetables = WorkspaceCache<gsl_fft_complex_wavetable, gsl_fft_complex_wavetable_alloc, gsl_fft_complex_wavetable_free>;
+    using ComplexWorkspaces = WorkspaceCache<gsl_fft_complex_workspace, gsl_fft_complex_workspace_alloc, gsl_fft_complex_workspace_free>;
+
+    // Transforms `count` real sequences of length n, sequence i starting at
+    // data + i * distance, with one lease of the tables for all of them
+    inline auto fft_real_many(double *data, size_t stride, size_t n, size_t count, size_t distance, FFT::Direction direction) -> void
+    {
+      ErrorHandlerOff errors;
+      auto workspace = RealWorkspaces::acquire(n);
+      if (direction == FFT::Direction::Forward)
+      {
+        auto wavetable = RealWavetables::acquire(n);
+        for (size_t i = 0; i < count; i++)
+          check_status(gsl_fft_real_transform(data + i * distance, stride, n, wavetable.get(), workspace.get()));
+        return;
+      }
+
+      auto wavetable = HalfcomplexWavetables::acquire(n);
+      for (size_t i = 0; i < count; i++)
+        check_status(gsl_fft_halfcomplex_inverse(data + i * distance, stride, n, wavetable.get(), workspace.get()));
+    }
+
+    // Same for complex sequences, stride and distance count complex values
+    inline auto fft_complex_many(double *data, size_t stride, size_t n, size_t count, size_t distance, FFT::Direction direction) -> void
+    {
+      ErrorHandlerOff errors;
+      auto wavetable = ComplexWavetables::acquire(n);
+      auto workspace = ComplexWorkspaces::acquire(n);
+      for (size_t i = 0; i < count; i++)
+      {
+        double *sequence = data + 2 * i * distance;
+        check_status(direction == FFT::Direction::Forward
+                             ? gsl_fft_complex_forward(sequence, stride, n, wavetable.get(), workspace.get())
+                             : gsl_fft_complex_inverse(sequence, stride, n, wavetable.get(), workspace.get()));
+      }
+    }
+
+    // Runs body(begin, end) over [0, count), in parallel for large batches
+    template <typename Body>
+    inline auto fft_for_batch(size_t count, size_t elements, Body body) -> void
+    {
+      if (count * elements < fft_parallel_threshold)
+      {
+        body(0, count);
+        return;
+      }
+      ThreadPool::shared().parallel_for(count, body);
+    }
+  }
+
+  inline auto FFT::real(Vector &data, Direction direction) -> void
+  {
+    if (data.size() == 0)
+      throw std::range_error{"FFT of an empty vector"};
+
+    gsl_vector *vector = data.get_gsl_vector();
+    bits::fft_real_many(vector->data, vector->stride, vector->size, 1, 0, direction);
+  }
+
+  inline auto FFT::complex(Vector &data, Direction direction) -> void
+  {
+    if (data.size() == 0 || data.size() % 2 != 0)
+      throw std::range_error{"Complex FFT needs an even non zero number of elements"};
+
+    // The interleaved pairs have to be contiguous, the pairs themselves not
+    gsl_vector *vector = data.get_gsl_vector();
+    if (vector->stride == 1)
+    {
+      bits::fft_complex_many(vector->data, 1, vector->size / 2, 1, 0, direction);
+      return;
+    }
+
+    Vector contiguous(data);
+    bits::fft_complex_many(contiguous.get_gsl_vector()->data, 1, vector->size / 2, 1, 0, direction);
+    gsl_vector_memcpy(vector, contiguous.get_gsl_vector());
+  }
+
+  inline auto FFT::real_rows(Matrix &data, Direction direction) -> void
+  {
+    gsl_matrix *matrix = data.get_gsl_matrix();
+    if (matrix == nullptr || matrix->size2 == 0)
+      throw std::range_error{"FFT of an empty matrix"};
+
+    bits::fft_for_batch(matrix->size1, matrix->size2, [=](size_t begin, size_t end)
+                        { bits::fft_real_many(matrix->data + begin * matrix->tda, 1, matrix->size2, end - begin, matrix->tda, direction); });
+  }
+
+  inline auto FFT::real_collumns(Matrix &data, Direction direction) -> void
+  {
+    gsl_matrix *matrix = data.get_gsl_matrix();
+    if (matrix == nullptr || matrix->size1 == 0)
+      throw std::range_error{"FFT of an empty matrix"};
+
+    const size_t n = matrix->size1;
+    const size_t num_blocks = (matrix->size2 + bits::fft_collumn_block - 1) / bits::fft_collumn_block;
+
+    // Blocks of collumns are gathered into contiguous sequences, transformed
+    // and scattered back, instead of transforming with a stride of tda
+    bits::fft_for_batch(num_blocks, n * bits::fft_collumn_block, [=](size_t begin, size_t end)
+                        {
+                          std::vector<double> gathered(n * bits::fft_collumn_block);
+                          for (size_t block = begin; block < end; block++)
+                          {
+                            const size_t first = block * bits::fft_collumn_block;
+                            const size_t width = std::min(bits::fft_collumn_block, matrix->size2 - first);
+
+                            for (size_t i = 0; i < n; i++)
+                            {
+                              const double *row = matrix->data + i * matrix->tda + first;
+                              for (size_t c = 0; c < width; c++)
+                                gathered[c * n + i] = row[c];
+                            }
+
+                            bits::fft_real_many(gathered.data(), 1, n, width, n, direction);
+
+                            for (size_t i = 0; i < n; i++)
+                            {
+                              double *row = matrix->data + i * matrix->tda + first;
+                              for (size_t c = 0; c < width; c++)
+                                row[c] = gathered[c * n + i];
+                            }
+                          } });
+  }
+
+  inline auto FFT::complex_rows(Matrix &data, Direction direction) -> void
+  {
+    gsl_matrix *matrix = data.get_gsl_matrix();
+    if (matrix == nullptr || matrix->size2 == 0 || matrix->size2 % 2 != 0)
+      throw std::range_error{"Complex FFT needs an even non zero number of collumns"};
+
+    // Rows start on a complex value only with an even tda, copies are packed
+    if (matrix->tda % 2 != 0)
+    {
+      Matrix packed(data);
+      complex_rows(packed, direction);
+      gsl_matrix_memcpy(matrix, packed.get_gsl_matrix());
+      return;
+    }
+
+    bits::fft_for_batch(matrix->size1, matrix->size2, [=](size_t begin, size_t end)
+                        { bits::fft_complex_many(matrix->data + begin * matrix->tda, 1, matrix->size2 / 2, end - begin, matrix->tda / 2, direction); });
+  }
+
+  inline auto FFT::unpack(const Vector &halfcomplex) -> Vector
+  {
+    Vector result(2 * halfcomplex.size());
+    unpack(halfcomplex, result);
+    return result;
+  }
+
+  inline auto FFT::unpack(const Vector &halfcomplex, Vector &complex) -> void
+  {
+    const size_t n = halfcomplex.size();
+    if (n == 0 || complex.size() != 2 * n)
+      throw std::range_error{"Diffrent sizes of half-complex and complex vectors"};
+
+    // gsl_fft_halfcomplex_unpack takes one stride for both arrays
+    bits::ErrorHandlerOff errors;
+    const gsl_vector *input = halfcomplex.get_gsl_vector();
+    gsl_vector *output = complex.get_gsl_vector();
+    if (input->stride == 1 && output->stride == 1)
+    {
+      bits::check_status(gsl_fft_halfcomplex_unpack(input->data, output->data, 1, n));
+      return;
+    }
+
+    const Vector contiguous_input = input->stride == 1 ? Vector::view(input->data, n) : Vector(halfcomplex);
+    Vector contiguous_output = output->stride == 1 ? Vector::view(output->data, 2 * n) : Vector(2 * n);
+    bits::check_status(gsl_fft_halfcomplex_unpack(contiguous_input.get_gsl_vector()->data, contiguous_output.get_gsl_vector()->data, 1, n));
+    if (output->stride != 1)
+      gsl_vector_memcpy(output, contiguous_output.get_gsl_vector());
+  }
+
+  inline auto FFT::unpack_rows(const Matrix &halfcomplex) -> Matrix
+  {
+    const gsl_matrix *input = halfcomplex.get_gsl_matrix();
+    if (input == nullptr || input->size2 == 0)
+      throw std::range_error{"Unpacking an empty matrix"};
+
+    Matrix result(input->size1, 2 * input->size2);
+    gsl_matrix *output = result.get_gsl_matrix();
+    bits::ErrorHandlerOff errors;
+    bits::fft_for_batch(input->size1, input->size2, [=](size_t begin, size_t end)
+                        {
+                          for (size_t i = begin; i < end; i++)
+                            bits::check_status(gsl_fft_halfcomplex_unpack(input->data + i * input->tda, output->data + i * output->tda, 1, input->size2));
+                        });
+    return result;
+  }
+
+  inline auto FFT::clear_cache() -> void
+  {
+    bits::RealWavetables::clear();
+    bits::HalfcomplexWavetables::clear();
+    bits::RealWorkspaces::clear();
+    bits::ComplexWavetables::clear();
+    bits::ComplexWorkspaces::clear();
+  }
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <stdexcept>
+
+#include "bits/matrix-view.h"
+#include "matrix.h"
+#include "vector.h"
+
+// std::mdspan adapters need a C++23 standard library, test/cxx23 checks them
+#if __has_include(<mdspan>)
+#include <mdspan>
+#endif
+#if defined(__cpp_lib_mdspan) && __cpp_lib_mdspan >= 202207L
+#define GSL_WRAPPER_HAS_MDSPAN 1
+#include <array>
+#endif
+
+// Eigen adapters are compiled when the build found Eigen and defined
+// GSL_WRAPPER_HAVE_EIGEN
+#ifdef GSL_WRAPPER_HAVE_EIGEN
+#include <Eigen/Core>
+#endif
+
+namespace gsl_wrapper
+{
+  // Adapters presenting the data of a Matrix, Vector or matrix row as
+  // std::mdspan or Eigen maps and taking theirs back, all without copying
+  //
+  // Both directions only alias the memory: the object owning the data has to
+  // outlive the adapter. Non-const Matrix and Vector adapters detach shared
+  // copy on write storage first, like any other write access. Rows of a const
+  // matrix give const spans and maps.
+
+#ifdef GSL_WRAPPER_HAS_MDSPAN
+  using MatrixSpan = std::mdspan<double, std::dextents<size_t, 2>, std::layout_stride>;
+  using ConstMatrixSpan = std::mdspan<const double, std::dextents<size_t, 2>, std::layout_stride>;
+  using VectorSpan = std::mdspan<double, std::dextents<size_t, 1>, std::layout_stride>;
+  using ConstVectorSpan = std::mdspan<const double, std::dextents<size_t, 1>, std::layout_stride>;
+
+  inline auto as_mdspan(Matrix &matrix) -> MatrixSpan
+  {
+    gsl_matrix *view = matrix.get_gsl_matrix();
+    return MatrixSpan{view->data, MatrixSpan::mapping_type{std::dextents<size_t, 2>{view->size1, view->size2}, std::array<size_t, 2>{view->tda, 1}}};
+  }
+
+  inline auto as_mdspan(const Matrix &matrix) -> ConstMatrixSpan
+  {
+    const gsl_matrix *view = matrix.get_gsl_matrix();
+    return ConstMatrixSpan{view->data, ConstMatrixSpan::mapping_type{std::dextents<size_t, 2>{view->size1, view->size2}, std::array<size_t, 2>{view->tda, 1}}};
+  }
+
+  inline auto as_mdspan(Vector &vector) -> VectorSpan
+  {
+    gsl_vector *view = vector.get_gsl_vector();
+    return VectorSpan{view->data, VectorSpan::mapping_type{std::dextents<size_t, 1>{view->size}, std::array<size_t, 1>{view->stride}}};
+  }
+
+  inline auto as_mdspan(const Vector &vector) -> ConstVectorSpan
+  {
+    const gsl_vector *view = vector.get_gsl_vector();
+    return ConstVectorSpan{view->data, ConstVectorSpan::mapping_type{std::dextents<size_t, 1>{view->size}, std::array<size_t, 1>{view->stride}}};
+  }
+
+  inline auto as_mdspan(bits::MatrixRow &row) -> VectorSpan
+  {
+    return VectorSpan{row.data(), VectorSpan::mapping_type{std::dextents<size_t, 1>{row.size()}, std::array<size_t, 1>{1}}};
+  }
+
+  inline auto as_mdspan(bits::MatrixRow &&row) -> VectorSpan
+  {
+    return as_mdspan(row);
+  }
+
+  inline auto as_mdspan(const bits::MatrixRow &row) -> ConstVectorSpan
+  {
+    return ConstVectorSpan{row.data(), ConstVectorSpan::mapping_type{std::dextents<size_t, 1>{row.size()}, std::array<size_t, 1>{1}}};
+  }
+
+  inline auto as_mdspan(const bits::ConstMatrixRow &row) -> ConstVectorSpan
+  {
+    return ConstVectorSpan{row.data(), ConstVectorSpan::mapping_type{std::dextents<size_t, 1>{row.size()}, std::array<size_t, 1>{1}}};
+  }
+
+  // Any layout with contiguous rows can back a Matrix, collumn-major ones can not
+  template <typename Extents, typename Layout, typename Accessor>
+  inline auto from_mdspan(std::mdspan<double, Extents, Layout, Accessor> span) -> Matrix
+  {
+    static_assert(Extents::rank() == 2, "Only two dimensional mdspans can be viewed as a Matrix");
+    if (span.extent(1) > 1 && span.stride(1) != 1)
+      throw std::runtime_error{"Only mdspans with contiguous rows can be viewed as a Matrix"};
+
+    const size_t tda = span.extent(0) > 1 ? span.stride(0) : span.extent(1);
+    return Matrix::view(span.data_handle(), span.extent(0), span.extent(1), tda);
+  }
+
+  template <typename Extents, typename Layout, typename Accessor>
+  inline auto vector_from_mdspan(std::mdspan<double, Extents, Layout, Accessor> span) -> Vector
+  {
+    static_assert(Extents::rank() == 1, "Only one dimensional mdspans can be viewed as a Vector");
+    return Vector::view(span.data_handle(), span.extent(0), span.extent(0) > 1 ? span.stride(0) : 1);
+  }
+#endif
+
+#ifdef GSL_WRAPPER_HAVE_EIGEN
+  using EigenRowMajorMatrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+  using EigenMatrixMap = Eigen::Map<EigenRowMajorMatrix, Eigen::Unaligned, Eigen::OuterStride<>>;
+  using ConstEigenMatrixMap = Eigen::Map<const EigenRowMajorMatrix, Eigen::Unaligned, Eigen::OuterStride<>>;
+  using EigenVectorMap = Eigen::Map<Eigen::VectorXd, Eigen::Unaligned, Eigen::InnerStride<>>;
+  using ConstEigenVectorMap = Eigen::Map<const Eigen::VectorXd, Eigen::Unaligned, Eigen::InnerStride<>>;
+
+  inline auto as_eigen(Matrix &matrix) -> EigenMatrixMap
+  {
+    gsl_matrix *view = matrix.get_gsl_matrix();
+    return EigenMatrixMap{view->data, Eigen::Index(view->size1), Eigen::Index(view->size2), Eigen::OuterStride<>(view->tda)};
+  }
+
+  inline auto as_eigen(const Matrix &matrix) -> ConstEigenMatrixMap
+  {
+    const gsl_matrix *view = matrix.get_gsl_matrix();
+    return ConstEigenMatrixMap{view->data, Eigen::Index(view->size1), Eigen::Index(view->size2), Eigen::OuterStride<>(view->tda)};
+  }
+
+  inline auto as_eigen(Vector &vector) -> EigenVectorMap
+  {
+    gsl_vector *view = vector.get_gsl_vector();
+    return EigenVectorMap{view->data, Eigen::Index(view->size), Eigen::InnerStride<>(view->stride)};
+  }
+
+  inline auto as_eigen(const Vector &vector) -> ConstEigenVectorMap
+  {
+    const gsl_vector *view = vector.get_gsl_vector();
+    return ConstEigenVectorMap{view->data, Eigen::Index(view->size), Eigen::InnerStride<>(view->stride)};
+  }
+
+  inline auto as_eigen(bits::MatrixRow &row) -> EigenVectorMap
+  {
+    return EigenVectorMap{row.data(), Eigen::Index(row.size()), Eigen::InnerStride<>(1)};
+  }
+
+  inline auto as_eigen(bits::MatrixRow &&row) -> EigenVectorMap
+  {
+    return as_eigen(row);
+  }
+
+  inline auto as_eigen(const bits::MatrixRow &row) -> ConstEigenVectorMap
+  {
+    return ConstEigenVectorMap{row.data(), Eigen::Index(row.size()), Eigen::InnerStride<>(1)};
+  }
+
+  inline auto as_eigen(const bits::ConstMatrixRow &row) -> ConstEigenVectorMap
+  {
+    return ConstEigenVectorMap{row.data(), Eigen::Index(row.size()), Eigen::InnerStride<>(1)};
+  }
+
+  inline auto from_eigen(EigenMatrixMap map) -> Matrix
+  {
+    return Matrix::view(map.data(), map.rows(), map.cols(), map.outerStride());
+  }
+
+  inline auto from_eigen(EigenRowMajorMatrix &matrix) -> Matrix
+  {
+    return Matrix::view(matrix.data(), matrix.rows(), matrix.cols());
+  }
+
+  // Eigen matrices are collumn-major by default, their storage is the
+  // row-major storage of the transpose
+  inline auto from_eigen_transposed(Eigen::MatrixXd &matrix) -> Matrix
+  {
+    return Matrix::view(matrix.data(), matrix.cols(), matrix.rows());
+  }
+
+  inline auto from_eigen(EigenVectorMap map) -> Vector
+  {
+    return Vector::view(map.data(), map.size(), map.innerStride());
+  }
+
+  inline auto from_eigen(Eigen::VectorXd &vector) -> Vector
+  {
+    return Vector::view(vector.data(), vector.size());
+  }
+#endif
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdexcept>
+#include <utility>
+
+#include <gsl/gsl_blas.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_vector.h>
+
+#include "bits/gemm.h"
+#include "krylov.h"
+#include "matrix.h"
+#include "vector.h"
+
+namespace gsl_wrapper
+{
+  // Kronecker product A ⊗ B applied without forming it
+  //
+  // For a p x q matrix A and an r x s matrix B, x read row by row as the
+  // q x s matrix X gives (A ⊗ B) x as the p x r matrix A X B^T read row by
+  // row. Two small products replace the (p r) x (q s) dense one.
+  class KroneckerOperator
+  {
+  public:
+    // Constructors
+    KroneckerOperator(Matrix a, Matrix b);
+
+    // Member functions
+    auto num_rows() const -> size_t;
+    auto num_collumns() const -> size_t;
+    auto apply(const Vector &x, Vector &y) const -> void;
+    auto to_matrix() const -> Matrix;
+    auto to_linear_operator() const -> LinearOperator;
+
+    // Operators
+    auto operator*(const Vector &x) const -> Vector;
+
+  private:
+    Matrix m_a;
+    Matrix m_b;
+  };
+
+  inline KroneckerOperator::KroneckerOperator(Matrix a, Matrix b)
+      : m_a{std::move(a)}, m_b{std::move(b)}
+  {
+    if (m_a.num_rows() == 0 || m_a.num_collumns() == 0 || m_b.num_rows() == 0 || m_b.num_collumns() == 0)
+      throw std::range_error{"Kronecker product of an empty matrix"};
+  }
+
+  inline auto KroneckerOperator::num_rows() const -> size_t
+  {
+    return m_a.num_rows() * m_b.num_rows();
+  }
+
+  inline auto KroneckerOperator::num_collumns() const -> size_t
+  {
+    return m_a.num_collumns() * m_b.num_collumns();
+  }
+
+  inline auto KroneckerOperator::apply(const Vector &x, Vector &y) const -> void
+  {
+    if (x.size() != num_collumns() || y.size() != num_rows())
+      throw std::range_error{"Diffrent sizes of Kronecker operator and vectors"};
+
+    const size_t p = m_a.num_rows();
+    const size_t q = m_a.num_collumns();
+    const size_t r = m_b.num_rows();
+    const size_t s = m_b.num_collumns();
+
+    // Reshaping needs contiguous elements, strided vectors go through a copy
+    const Vector contiguous_x = x.get_gsl_vector()->stride == 1 ? Vector::view(x.get_gsl_vector()->data, x.size()) : Vector(x);
+    Vector contiguous_y = y.get_gsl_vector()->stride == 1 ? Vector::view(y.get_gsl_vector()->data, y.size()) : Vector(y.size());
+
+    gsl_matrix_const_view x_matrix = gsl_matrix_const_view_array(contiguous_x.get_gsl_vector()->data, q, s);
+    gsl_matrix_view y_matrix = gsl_matrix_view_array(contiguous_y.get_gsl_vector()->data, p, r);
+
+    // Whichever order of the two products needs fewer multiplications
+    if (q * r * (s + p) <= p * s * (q + r))
+    {
+      Matrix temporary(q, r);
+      bits::dgemm(CblasNoTrans, CblasTrans, 1.0, &x_matrix.matrix, m_b.get_gsl_matrix(), 0.0, temporary.get_gsl_matrix());
+      bits::dgemm(CblasNoTrans, CblasNoTrans, 1.0, m_a.get_gsl_matrix(), temporary.get_gsl_matrix(), 0.0, &y_matrix.matrix);
+    }
+    else
+    {
+      Matrix temporary(p, s);
+      bits::dgemm(CblasNoTrans, CblasNoTrans, 1.0, m_a.get_gsl_matrix(), &x_matrix.matrix, 0.0, temporary.get_gsl_matrix());
+      bits::dgemm(CblasNoTrans, CblasTrans, 1.0, temporary.get_gsl_matrix(), m_b.get_gsl_matrix(), 0.0, &y_matrix.matrix);
+    }
+
+    if (y.get_gsl_vector()->stride != 1)
+      gsl_vector_memcpy(y.get_gsl_vector(), contiguous_y.get_gsl_vector());
+  }
+
+  inline auto KroneckerOperator::to_matrix() const -> Matrix
+  {
+    return kron(m_a, m_b);
+  }
+
+  inline auto KroneckerOperator::to_linear_operator() const -> LinearOperator
+  {
+    if (num_rows() != num_collumns())
+      throw std::range_error{"Linear operator of a non square Kronecker product"};
+
+    return LinearOperator(num_rows(), [kronecker = *this](const Vector &x, Vector &y)
+                          { kronecker.apply(x, y); });
+  }
+
+  inline auto KroneckerOperator::operator*(const Vector &x) const -> Vector
+  {
+    Vector result(num_rows());
+    apply(x, result);
+    return result;
+  }
+}
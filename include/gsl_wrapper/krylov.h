@@ -0,0 +1,732 @@
+#pragma once
+
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <gsl/gsl_blas.h>
+#include <gsl/gsl_spblas.h>
+#include <gsl/gsl_spmatrix.h>
+
+#include "matrix.h"
+#include "vector.h"
+
+namespace gsl_wrapper
+{
+  // Square operator y = A x used by the iterative solvers
+  //
+  // Dense and sparse matrices are referenced, not copied, so they have to
+  // outlive the operator. Temporary matrices are rejected for that reason.
+  class LinearOperator
+  {
+  public:
+    // Constructors
+    explicit LinearOperator(const Matrix &matrix);
+    explicit LinearOperator(const gsl_spmatrix *matrix);
+    LinearOperator(Matrix &&matrix) = delete;
+    LinearOperator(size_t size, std::function<void(const Vector &x, Vector &y)> function);
+
+    // Member functions
+    auto size() const -> size_t;
+    auto apply(const Vector &x, Vector &y) const -> void;
+
+  private:
+    size_t m_size;
+    std::function<void(const Vector &x, Vector &y)> m_function;
+  };
+
+  // Approximate inverse M^-1 applied as z = M^-1 r
+  class Preconditioner
+  {
+  public:
+    virtual ~Preconditioner() = default;
+    virtual auto apply(const Vector &r, Vector &z) const -> void = 0;
+  };
+
+  class IdentityPreconditioner : public Preconditioner
+  {
+  public:
+    auto apply(const Vector &r, Vector &z) const -> void override;
+  };
+
+  // Scales by the inverse of the diagonal of A
+  class JacobiPreconditioner : public Preconditioner
+  {
+  public:
+    JacobiPreconditioner(const Matrix &matrix);
+    JacobiPreconditioner(const gsl_spmatrix *matrix);
+
+    auto apply(const Vector &r, Vector &z) const -> void override;
+
+  private:
+    auto invert_diagonal() -> void;
+
+    Vector m_inverse_diagonal;
+  };
+
+  // Incomplete LU factorization keeping the sparsity pattern of A
+  class ILU0Preconditioner : public Preconditioner
+  {
+  public:
+    ILU0Preconditioner(const Matrix &matrix);
+    ILU0Preconditioner(const gsl_spmatrix *matrix);
+
+    auto apply(const Vector &r, Vector &z) const -> void override;
+
+  private:
+    auto factorize(size_t size, const std::map<std::pair<size_t, size_t>, double> &entries) -> void;
+
+    // Factors stored row by row with sorted collumns, L has a unit diagonal
+    std::vector<size_t> m_row_start;
+    std::vector<size_t> m_collumn;
+    std::vector<size_t> m_diagonal;
+    std::vector<double> m_value;
+  };
+
+  struct SolverResult
+  {
+    size_t iterations;
+    double residual_norm;
+    bool converged;
+  };
+
+  // Settings and the residual callback shared by the Krylov solvers
+  //
+  // The callback gets the iteration number and the residual norm after every
+  // iteration, the converging one included. Returning false stops the solve
+  // early.
+  class KrylovSolver
+  {
+  public:
+    using Callback = std::function<bool(size_t iteration, double residual_norm)>;
+
+    // Member functions
+    auto size() const -> size_t;
+    auto set_tolerance(double relative_tolerance, double absolute_tolerance = 0.0) -> void;
+    auto set_max_iterations(size_t max_iterations) -> void;
+    auto set_callback(Callback callback) -> void;
+
+  protected:
+    KrylovSolver(size_t size);
+
+    auto check_sizes(const LinearOperator &op, const Vector &b, const Vector &x) const -> void;
+    auto threshold(const Vector &b) const -> double;
+    auto report(size_t iteration, double residual_norm) const -> bool;
+
+    size_t m_size;
+    double m_relative_tolerance;
+    double m_absolute_tolerance;
+    size_t m_max_iterations;
+    Callback m_callback;
+  };
+
+  // Conjugate gradient method for symmetric positive definite systems
+  class ConjugateGradient : public KrylovSolver
+  {
+  public:
+    ConjugateGradient(size_t size);
+
+    auto solve(const LinearOperator &op, const Vector &b, Vector &x) -> SolverResult;
+    auto solve(const LinearOperator &op, const Vector &b, Vector &x, const Preconditioner &preconditioner) -> SolverResult;
+
+  private:
+    Vector m_r;
+    Vector m_z;
+    Vector m_p;
+    Vector m_Ap;
+  };
+
+  // Stabilized biconjugate gradient method for general systems
+  class BiCGSTAB : public KrylovSolver
+  {
+  public:
+    BiCGSTAB(size_t size);
+
+    auto solve(const LinearOperator &op, const Vector &b, Vector &x) -> SolverResult;
+    auto solve(const LinearOperator &op, const Vector &b, Vector &x, const Preconditioner &preconditioner) -> SolverResult;
+
+  private:
+    Vector m_r;
+    Vector m_r_hat;
+    Vector m_p;
+    Vector m_p_hat;
+    Vector m_v;
+    Vector m_s;
+    Vector m_s_hat;
+    Vector m_t;
+  };
+
+  // Restarted GMRES(m) for general systems, right preconditioned
+  class GMRES : public KrylovSolver
+  {
+  public:
+    GMRES(size_t size, size_t restart = 30);
+
+    auto solve(const LinearOperator &op, const Vector &b, Vector &x) -> SolverResult;
+    auto solve(const LinearOperator &op, const Vector &b, Vector &x, const Preconditioner &preconditioner) -> SolverResult;
+
+  private:
+    size_t m_restart;
+    std::vector<Vector> m_basis;
+    Matrix m_hessenberg;
+    Vector m_cosines;
+    Vector m_sines;
+    Vector m_rhs;
+    Vector m_r;
+    Vector m_w;
+    Vector m_z;
+  };
+
+  namespace bits
+  {
+    inline auto krylov_dot(const Vector &x, const Vector &y) -> double
+    {
+      double result;
+      gsl_blas_ddot(x.get_gsl_vector(), y.get_gsl_vector(), &result);
+      return result;
+    }
+
+    inline auto krylov_norm(const Vector &x) -> double
+    {
+      return gsl_blas_dnrm2(x.get_gsl_vector());
+    }
+
+    // y += alpha x
+    inline auto krylov_axpy(double alpha, const Vector &x, Vector &y) -> void
+    {
+      gsl_blas_daxpy(alpha, x.get_gsl_vector(), y.get_gsl_vector());
+    }
+
+    // r = b - A x
+    inline auto krylov_residual(const LinearOperator &op, const Vector &b, const Vector &x, Vector &r) -> void
+    {
+      op.apply(x, r);
+      gsl_vector_scale(r.get_gsl_vector(), -1.0);
+      gsl_vector_add(r.get_gsl_vector(), b.get_gsl_vector());
+    }
+
+    // Nonzero entries of a sparse matrix in any storage format, keyed by (row, collumn)
+    inline auto sparse_entries(const gsl_spmatrix *matrix) -> std::map<std::pair<size_t, size_t>, double>
+    {
+      std::map<std::pair<size_t, size_t>, double> entries;
+
+      if (matrix->sptype == GSL_SPMATRIX_TRIPLET)
+      {
+        for (size_t k = 0; k < matrix->nz; k++)
+        {
+          entries[{static_cast<size_t>(matrix->i[k]), static_cast<size_t>(matrix->p[k])}] += matrix->data[k];
+        }
+      }
+      else
+      {
+        const bool by_rows = matrix->sptype == GSL_SPMATRIX_CRS;
+        const size_t outer = by_rows ? matrix->size1 : matrix->size2;
+        for (size_t o = 0; o < outer; o++)
+        {
+          for (auto k = static_cast<size_t>(matrix->p[o]); k < static_cast<size_t>(matrix->p[o + 1]); k++)
+          {
+            const auto inner = static_cast<size_t>(matrix->i[k]);
+            entries[by_rows ? std::make_pair(o, inner) : std::make_pair(inner, o)] += matrix->data[k];
+          }
+        }
+      }
+
+      return entries;
+    }
+  }
+
+  inline LinearOperator::LinearOperator(const Matrix &matrix)
+      : m_size{matrix.num_rows()},
+        m_function{[&matrix](const Vector &x, Vector &y)
+                   { gsl_blas_dgemv(CblasNoTrans, 1.0, matrix.get_gsl_matrix(), x.get_gsl_vector(), 0.0, y.get_gsl_vector()); }}
+  {
+    if (matrix.num_rows() != matrix.num_collumns())
+      throw std::range_error{"Linear operator has to be square"};
+  }
+
+  inline LinearOperator::LinearOperator(const gsl_spmatrix *matrix)
+      : m_size{matrix->size1},
+        m_function{[matrix](const Vector &x, Vector &y)
+                   { gsl_spblas_dgemv(CblasNoTrans, 1.0, matrix, x.get_gsl_vector(), 0.0, y.get_gsl_vector()); }}
+  {
+    if (matrix->size1 != matrix->size2)
+      throw std::range_error{"Linear operator has to be square"};
+  }
+
+  inline LinearOperator::LinearOperator(size_t size, std::function<void(const Vector &x, Vector &y)> function)
+      : m_size{size}, m_function{std::move(function)}
+  {
+  }
+
+  inline auto LinearOperator::size() const -> size_t
+  {
+    return m_size;
+  }
+
+  inline auto LinearOperator::apply(const Vector &x, Vector &y) const -> void
+  {
+    m_function(x, y);
+  }
+
+  inline auto IdentityPreconditioner::apply(const Vector &r, Vector &z) const -> void
+  {
+    gsl_vector_memcpy(z.get_gsl_vector(), r.get_gsl_vector());
+  }
+
+  inline JacobiPreconditioner::JacobiPreconditioner(const Matrix &matrix)
+      : m_inverse_diagonal(matrix.num_rows())
+  {
+    if (matrix.num_rows() != matrix.num_collumns())
+      throw std::range_error{"Preconditioned matrix has to be square"};
+
+    for (size_t i = 0; i < matrix.num_rows(); i++)
+    {
+      m_inverse_diagonal[i] = matrix[i][i];
+    }
+    invert_diagonal();
+  }
+
+  inline JacobiPreconditioner::JacobiPreconditioner(const gsl_spmatrix *matrix)
+      : m_inverse_diagonal(matrix->size1)
+  {
+    if (matrix->size1 != matrix->size2)
+      throw std::range_error{"Preconditioned matrix has to be square"};
+
+    for (auto &&[position, value] : bits::sparse_entries(matrix))
+    {
+      if (position.first == position.second)
+        m_inverse_diagonal[position.first] = value;
+    }
+    invert_diagonal();
+  }
+
+  inline auto JacobiPreconditioner::invert_diagonal() -> void
+  {
+    for (auto &&el : m_inverse_diagonal)
+    {
+      if (el == 0.0)
+        throw std::runtime_error{"Jacobi preconditioner needs a nonzero diagonal"};
+      el = 1.0 / el;
+    }
+  }
+
+  inline auto JacobiPreconditioner::apply(const Vector &r, Vector &z) const -> void
+  {
+    for (size_t i = 0; i < r.size(); i++)
+    {
+      z[i] = r[i] * m_inverse_diagonal[i];
+    }
+  }
+
+  inline ILU0Preconditioner::ILU0Preconditioner(const Matrix &matrix)
+  {
+    if (matrix.num_rows() != matrix.num_collumns())
+      throw std::range_error{"Preconditioned matrix has to be square"};
+
+    std::map<std::pair<size_t, size_t>, double> entries;
+    for (size_t i = 0; i < matrix.num_rows(); i++)
+    {
+      for (size_t j = 0; j < matrix.num_collumns(); j++)
+      {
+        if (matrix[i][j] != 0.0)
+          entries[{i, j}] = matrix[i][j];
+      }
+    }
+    factorize(matrix.num_rows(), entries);
+  }
+
+  inline ILU0Preconditioner::ILU0Preconditioner(const gsl_spmatrix *matrix)
+  {
+    if (matrix->size1 != matrix->size2)
+      throw std::range_error{"Preconditioned matrix has to be square"};
+
+    factorize(matrix->size1, bits::sparse_entries(matrix));
+  }
+
+  inline auto ILU0Preconditioner::factorize(size_t size, const std::map<std::pair<size_t, size_t>, double> &entries) -> void
+  {
+    constexpr size_t missing = std::numeric_limits<size_t>::max();
+
+    // Compressed rows, the map is already ordered by row and collumn
+    m_row_start.assign(size + 1, 0);
+    m_diagonal.assign(size, missing);
+    for (auto &&[position, value] : entries)
+    {
+      if (position.first == position.second)
+        m_diagonal[position.first] = m_collumn.size();
+      m_collumn.push_back(position.second);
+      m_value.push_back(value);
+      ++m_row_start[position.first + 1];
+    }
+    for (size_t i = 0; i < size; i++)
+    {
+      m_row_start[i + 1] += m_row_start[i];
+      if (m_diagonal[i] == missing || m_value[m_diagonal[i]] == 0.0)
+        throw std::runtime_error{"ILU(0) preconditioner needs a nonzero diagonal"};
+    }
+
+    // IKJ elimination restricted to the existing nonzeros
+    std::vector<size_t> position_in_row(size, missing);
+    for (size_t i = 1; i < size; i++)
+    {
+      for (size_t k = m_row_start[i]; k < m_row_start[i + 1]; k++)
+      {
+        position_in_row[m_collumn[k]] = k;
+      }
+
+      for (size_t k = m_row_start[i]; k < m_diagonal[i]; k++)
+      {
+        const size_t pivot_row = m_collumn[k];
+        m_value[k] /= m_value[m_diagonal[pivot_row]];
+
+        for (size_t l = m_diagonal[pivot_row] + 1; l < m_row_start[pivot_row + 1]; l++)
+        {
+          const size_t target = position_in_row[m_collumn[l]];
+          if (target != missing)
+            m_value[target] -= m_value[k] * m_value[l];
+        }
+      }
+
+      for (size_t k = m_row_start[i]; k < m_row_start[i + 1]; k++)
+      {
+        position_in_row[m_collumn[k]] = missing;
+      }
+    }
+  }
+
+  inline auto ILU0Preconditioner::apply(const Vector &r, Vector &z) const -> void
+  {
+    const size_t size = m_diagonal.size();
+
+    // Forward substitution with L, then backward substitution with U
+    for (size_t i = 0; i < size; i++)
+    {
+      double sum = r[i];
+      for (size_t k = m_row_start[i]; k < m_diagonal[i]; k++)
+      {
+        sum -= m_value[k] * z[m_collumn[k]];
+      }
+      z[i] = sum;
+    }
+
+    for (size_t i = size; i-- > 0;)
+    {
+      double sum = z[i];
+      for (size_t k = m_diagonal[i] + 1; k < m_row_start[i + 1]; k++)
+      {
+        sum -= m_value[k] * z[m_collumn[k]];
+      }
+      z[i] = sum / m_value[m_diagonal[i]];
+    }
+  }
+
+  inline KrylovSolver::KrylovSolver(size_t size)
+      : m_size{size},
+        m_relative_tolerance{1e-10},
+        m_absolute_tolerance{0.0},
+        m_max_iterations{1000}
+  {
+  }
+
+  inline auto KrylovSolver::size() const -> size_t
+  {
+    return m_size;
+  }
+
+  inline auto KrylovSolver::set_tolerance(double relative_tolerance, double absolute_tolerance) -> void
+  {
+    m_relative_tolerance = relative_tolerance;
+    m_absolute_tolerance = absolute_tolerance;
+  }
+
+  inline auto KrylovSolver::set_max_iterations(size_t max_iterations) -> void
+  {
+    m_max_iterations = max_iterations;
+  }
+
+  inline auto KrylovSolver::set_callback(Callback callback) -> void
+  {
+    m_callback = std::move(callback);
+  }
+
+  inline auto KrylovSolver::check_sizes(const LinearOperator &op, const Vector &b, const Vector &x) const -> void
+  {
+    if (op.size() != m_size || b.size() != m_size || x.size() != m_size)
+      throw std::range_error{"Solver size does not match the system"};
+  }
+
+  inline auto KrylovSolver::threshold(const Vector &b) const -> double
+  {
+    return std::max(m_relative_tolerance * bits::krylov_norm(b), m_absolute_tolerance);
+  }
+
+  inline auto KrylovSolver::report(size_t iteration, double residual_norm) const -> bool
+  {
+    return !m_callback || m_callback(iteration, residual_norm);
+  }
+
+  inline ConjugateGradient::ConjugateGradient(size_t size)
+      : KrylovSolver(size), m_r(size), m_z(size), m_p(size), m_Ap(size)
+  {
+  }
+
+  inline auto ConjugateGradient::solve(const LinearOperator &op, const Vector &b, Vector &x) -> SolverResult
+  {
+    return solve(op, b, x, IdentityPreconditioner{});
+  }
+
+  inline auto ConjugateGradient::solve(const LinearOperator &op, const Vector &b, Vector &x, const Preconditioner &preconditioner) -> SolverResult
+  {
+    check_sizes(op, b, x);
+    const double target = threshold(b);
+
+    bits::krylov_residual(op, b, x, m_r);
+    double residual_norm = bits::krylov_norm(m_r);
+    if (residual_norm <= target)
+      return {0, residual_norm, true};
+
+    preconditioner.apply(m_r, m_z);
+    gsl_vector_memcpy(m_p.get_gsl_vector(), m_z.get_gsl_vector());
+    double rz = bits::krylov_dot(m_r, m_z);
+
+    for (size_t iteration = 1; iteration <= m_max_iterations; iteration++)
+    {
+      op.apply(m_p, m_Ap);
+      const double curvature = bits::krylov_dot(m_p, m_Ap);
+      if (curvature == 0.0)
+        return {iteration - 1, residual_norm, false};
+
+      const double alpha = rz / curvature;
+      bits::krylov_axpy(alpha, m_p, x);
+      bits::krylov_axpy(-alpha, m_Ap, m_r);
+
+      residual_norm = bits::krylov_norm(m_r);
+      const bool proceed = report(iteration, residual_norm);
+      if (residual_norm <= target)
+        return {iteration, residual_norm, true};
+      if (!proceed)
+        return {iteration, residual_norm, false};
+
+      preconditioner.apply(m_r, m_z);
+      const double rz_next = bits::krylov_dot(m_r, m_z);
+
+      // p = z + beta p
+      gsl_vector_scale(m_p.get_gsl_vector(), rz_next / rz);
+      gsl_vector_add(m_p.get_gsl_vector(), m_z.get_gsl_vector());
+      rz = rz_next;
+    }
+
+    return {m_max_iterations, residual_norm, false};
+  }
+
+  inline BiCGSTAB::BiCGSTAB(size_t size)
+      : KrylovSolver(size),
+        m_r(size), m_r_hat(size), m_p(size), m_p_hat(size),
+        m_v(size), m_s(size), m_s_hat(size), m_t(size)
+  {
+  }
+
+  inline auto BiCGSTAB::solve(const LinearOperator &op, const Vector &b, Vector &x) -> SolverResult
+  {
+    return solve(op, b, x, IdentityPreconditioner{});
+  }
+
+  inline auto BiCGSTAB::solve(const LinearOperator &op, const Vector &b, Vector &x, const Preconditioner &preconditioner) -> SolverResult
+  {
+    check_sizes(op, b, x);
+    const double target = threshold(b);
+
+    bits::krylov_residual(op, b, x, m_r);
+    double residual_norm = bits::krylov_norm(m_r);
+    if (residual_norm <= target)
+      return {0, residual_norm, true};
+
+    gsl_vector_memcpy(m_r_hat.get_gsl_vector(), m_r.get_gsl_vector());
+    gsl_vector_set_zero(m_p.get_gsl_vector());
+    gsl_vector_set_zero(m_v.get_gsl_vector());
+    double rho = 1.0;
+    double alpha = 1.0;
+    double omega = 1.0;
+
+    for (size_t iteration = 1; iteration <= m_max_iterations; iteration++)
+    {
+      const double rho_next = bits::krylov_dot(m_r_hat, m_r);
+      if (rho_next == 0.0 || omega == 0.0)
+        return {iteration - 1, residual_norm, false};
+
+      // p = r + beta (p - omega v)
+      const double beta = (rho_next / rho) * (alpha / omega);
+      bits::krylov_axpy(-omega, m_v, m_p);
+      gsl_vector_scale(m_p.get_gsl_vector(), beta);
+      gsl_vector_add(m_p.get_gsl_vector(), m_r.get_gsl_vector());
+
+      preconditioner.apply(m_p, m_p_hat);
+      op.apply(m_p_hat, m_v);
+
+      // Breakdown, r_hat is orthogonal to the new search direction
+      const double r_hat_v = bits::krylov_dot(m_r_hat, m_v);
+      if (r_hat_v == 0.0)
+        return {iteration - 1, residual_norm, false};
+      alpha = rho_next / r_hat_v;
+
+      // s = r - alpha v
+      gsl_vector_memcpy(m_s.get_gsl_vector(), m_r.get_gsl_vector());
+      bits::krylov_axpy(-alpha, m_v, m_s);
+      const double s_norm = bits::krylov_norm(m_s);
+      if (s_norm <= target)
+      {
+        bits::krylov_axpy(alpha, m_p_hat, x);
+        report(iteration, s_norm);
+        return {iteration, s_norm, true};
+      }
+
+      preconditioner.apply(m_s, m_s_hat);
+      op.apply(m_s_hat, m_t);
+      // Breakdown, omega would be undefined
+      const double t_t = bits::krylov_dot(m_t, m_t);
+      if (t_t == 0.0)
+      {
+        bits::krylov_axpy(alpha, m_p_hat, x);
+        return {iteration, s_norm, false};
+      }
+      omega = bits::krylov_dot(m_t, m_s) / t_t;
+
+      bits::krylov_axpy(alpha, m_p_hat, x);
+      bits::krylov_axpy(omega, m_s_hat, x);
+
+      // r = s - omega t
+      gsl_vector_memcpy(m_r.get_gsl_vector(), m_s.get_gsl_vector());
+      bits::krylov_axpy(-omega, m_t, m_r);
+      rho = rho_next;
+
+      residual_norm = bits::krylov_norm(m_r);
+      const bool proceed = report(iteration, residual_norm);
+      if (residual_norm <= target)
+        return {iteration, residual_norm, true};
+      if (!proceed)
+        return {iteration, residual_norm, false};
+    }
+
+    return {m_max_iterations, residual_norm, false};
+  }
+
+  inline GMRES::GMRES(size_t size, size_t restart)
+      : KrylovSolver(size),
+        m_restart{std::max<size_t>(1, std::min(restart, size))},
+        m_hessenberg(m_restart + 1, m_restart),
+        m_cosines(m_restart), m_sines(m_restart), m_rhs(m_restart + 1),
+        m_r(size), m_w(size), m_z(size)
+  {
+    m_basis.reserve(m_restart + 1);
+    for (size_t i = 0; i <= m_restart; i++)
+    {
+      m_basis.emplace_back(size);
+    }
+  }
+
+  inline auto GMRES::solve(const LinearOperator &op, const Vector &b, Vector &x) -> SolverResult
+  {
+    return solve(op, b, x, IdentityPreconditioner{});
+  }
+
+  inline auto GMRES::solve(const LinearOperator &op, const Vector &b, Vector &x, const Preconditioner &preconditioner) -> SolverResult
+  {
+    check_sizes(op, b, x);
+    const double target = threshold(b);
+
+    size_t iteration = 0;
+    double residual_norm = 0.0;
+    while (true)
+    {
+      bits::krylov_residual(op, b, x, m_r);
+      residual_norm = bits::krylov_norm(m_r);
+      if (residual_norm <= target)
+        return {iteration, residual_norm, true};
+      if (iteration >= m_max_iterations)
+        return {iteration, residual_norm, false};
+
+      gsl_vector_memcpy(m_basis[0].get_gsl_vector(), m_r.get_gsl_vector());
+      gsl_vector_scale(m_basis[0].get_gsl_vector(), 1.0 / residual_norm);
+      gsl_vector_set_zero(m_rhs.get_gsl_vector());
+      m_rhs[0] = residual_norm;
+
+      // Arnoldi process with Givens rotations keeping H upper triangular
+      size_t steps = 0;
+      bool stop = false;
+      for (size_t j = 0; j < m_restart && iteration < m_max_iterations; j++)
+      {
+        preconditioner.apply(m_basis[j], m_z);
+        op.apply(m_z, m_w);
+
+        for (size_t i = 0; i <= j; i++)
+        {
+          const double projection = bits::krylov_dot(m_w, m_basis[i]);
+          m_hessenberg[i][j] = projection;
+          bits::krylov_axpy(-projection, m_basis[i], m_w);
+        }
+        const double next_norm = bits::krylov_norm(m_w);
+        m_hessenberg[j + 1][j] = next_norm;
+        if (next_norm != 0.0)
+        {
+          gsl_vector_memcpy(m_basis[j + 1].get_gsl_vector(), m_w.get_gsl_vector());
+          gsl_vector_scale(m_basis[j + 1].get_gsl_vector(), 1.0 / next_norm);
+        }
+
+        for (size_t i = 0; i < j; i++)
+        {
+          const double upper = m_hessenberg[i][j];
+          const double lower = m_hessenberg[i + 1][j];
+          m_hessenberg[i][j] = m_cosines[i] * upper + m_sines[i] * lower;
+          m_hessenberg[i + 1][j] = -m_sines[i] * upper + m_cosines[i] * lower;
+        }
+
+        const double diagonal = m_hessenberg[j][j];
+        const double length = std::hypot(diagonal, next_norm);
+        m_cosines[j] = length == 0.0 ? 1.0 : diagonal / length;
+        m_sines[j] = length == 0.0 ? 0.0 : next_norm / length;
+        m_hessenberg[j][j] = length;
+        m_hessenberg[j + 1][j] = 0.0;
+        m_rhs[j + 1] = -m_sines[j] * m_rhs[j];
+        m_rhs[j] = m_cosines[j] * m_rhs[j];
+
+        ++iteration;
+        ++steps;
+        residual_norm = std::fabs(m_rhs[j + 1]);
+        const bool proceed = report(iteration, residual_norm);
+        if (residual_norm <= target || next_norm == 0.0)
+          break;
+        if (!proceed)
+        {
+          stop = true;
+          break;
+        }
+      }
+
+      // Back substitution for y, then x += M^-1 (V y)
+      for (size_t i = steps; i-- > 0;)
+      {
+        double sum = m_rhs[i];
+        for (size_t k = i + 1; k < steps; k++)
+        {
+          sum -= m_hessenberg[i][k] * m_rhs[k];
+        }
+        m_rhs[i] = m_hessenberg[i][i] == 0.0 ? 0.0 : sum / m_hessenberg[i][i];
+      }
+
+      gsl_vector_set_zero(m_w.get_gsl_vector());
+      for (size_t i = 0; i < steps; i++)
+      {
+        bits::krylov_axpy(m_rhs[i], m_basis[i], m_w);
+      }
+      preconditioner.apply(m_w, m_z);
+      bits::krylov_axpy(1.0, m_z, x);
+
+      if (stop)
+        return {iteration, residual_norm, false};
+    }
+  }
+}
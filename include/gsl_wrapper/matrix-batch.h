@@ -0,0 +1,544 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <gsl/gsl_linalg.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_permutation.h>
+
+#include "bits/thread-pool.h"
+#include "matrix.h"
+
+namespace gsl_wrapper
+{
+  // Placement of the matrices of a MatrixBatch in its storage
+  enum class BatchLayout
+  {
+    // Every matrix is one contiguous row-major block, viewable as a gsl_matrix
+    Strided,
+    // Element (i, j) of all matrices is stored next to each other, so the
+    // kernels run across the batch in SIMD lanes
+    Interleaved
+  };
+
+  // Fixed number of same-shaped matrices in one allocation
+  //
+  // The batched kernels are meant for many small matrices, where calling into
+  // BLAS once per matrix costs more than the arithmetic. They split the batch
+  // between the threads of the shared pool when there is enough work.
+  class MatrixBatch
+  {
+  public:
+    // Constructors
+    MatrixBatch(size_t count, size_t num_rows, size_t num_collumns, BatchLayout layout = BatchLayout::Interleaved);
+
+    // Member functions
+    auto count() const -> size_t;
+    auto num_rows() const -> size_t;
+    auto num_collumns() const -> size_t;
+    auto layout() const -> BatchLayout;
+    auto data() -> double *;
+    auto data() const -> const double *;
+
+    auto get(size_t index) const -> Matrix;
+    auto set(size_t index, const Matrix &matrix) -> void;
+    auto set_identity() -> void;
+    auto with_layout(BatchLayout layout) const -> MatrixBatch;
+
+    // Only matrices of a Strided batch are contiguous enough for a gsl_matrix
+    auto view(size_t index) -> gsl_matrix_view;
+    auto view(size_t index) const -> gsl_matrix_const_view;
+
+    // Elementwise operations, the batches must have the same shape and layout
+    auto multiply_elements(const MatrixBatch &other) -> MatrixBatch &;
+
+    // Operators
+    auto operator()(size_t index, size_t row, size_t collumn) -> double &;
+    auto operator()(size_t index, size_t row, size_t collumn) const -> const double &;
+    auto operator+=(const MatrixBatch &other) -> MatrixBatch &;
+    auto operator-=(const MatrixBatch &other) -> MatrixBatch &;
+    auto operator*=(double number) -> MatrixBatch &;
+
+  private:
+    auto offset(size_t index, size_t row, size_t collumn) const -> size_t;
+    auto elementwise(const MatrixBatch &other, const std::function<void(double *, const double *, size_t)> &kernel) -> void;
+
+    size_t m_count;
+    size_t m_numRows;
+    size_t m_numCollumns;
+    BatchLayout m_layout;
+    std::vector<double> m_data;
+  };
+
+  // c_k = alpha a_k b_k + beta c_k for every matrix of the batches
+  auto gemm(double alpha, const MatrixBatch &a, const MatrixBatch &b, double beta, MatrixBatch &c) -> void;
+  auto operator*(const MatrixBatch &a, const MatrixBatch &b) -> MatrixBatch;
+
+  // Solves a_k x_k = b_k with partial pivoting, a is overwritten by its LU
+  // factors and b by the solutions
+  //
+  // The batch is updated in place, so a singular matrix does not stop the
+  // others. Every non-singular system is still solved. The singular ones
+  // keep partial factors and unspecified right hand sides, and the
+  // runtime_error comes after the whole batch.
+  auto lu_solve(MatrixBatch &a, MatrixBatch &b) -> void;
+  auto inverse(const MatrixBatch &a) -> MatrixBatch;
+
+  namespace bits
+  {
+    // Lanes of an interleaved batch processed together, sized so the
+    // operands of a small kernel stay in cache
+    constexpr size_t batch_lane_tile = 64;
+
+    // Runs body(begin, end) over the batch, in parallel only when the work is
+    // large enough to pay for waking the pool
+    inline auto for_batch(size_t count, size_t work_per_matrix, const std::function<void(size_t, size_t)> &body) -> void
+    {
+      constexpr size_t parallel_threshold = size_t{1} << 16;
+      if (count * work_per_matrix < parallel_threshold)
+      {
+        body(0, count);
+        return;
+      }
+      ThreadPool::shared().parallel_for(count, body);
+    }
+
+    // C = alpha A B + beta C on the lanes [begin, end) of interleaved batches
+    inline auto gemm_interleaved(size_t m, size_t n, size_t k, size_t lanes, size_t begin, size_t end,
+                                 double alpha, const double *a, const double *b, double beta, double *c) -> void
+    {
+      for (size_t tile = begin; tile < end; tile += batch_lane_tile)
+      {
+        const size_t tile_end = std::min(tile + batch_lane_tile, end);
+
+        for (size_t ij = 0; ij < m * n; ij++)
+        {
+          double *c_ij = c + ij * lanes;
+          for (size_t lane = tile; lane < tile_end; lane++)
+            c_ij[lane] = beta == 0.0 ? 0.0 : beta * c_ij[lane];
+        }
+
+        for (size_t i = 0; i < m; i++)
+        {
+          for (size_t p = 0; p < k; p++)
+          {
+            const double *a_ip = a + (i * k + p) * lanes;
+            for (size_t j = 0; j < n; j++)
+            {
+              const double *b_pj = b + (p * n + j) * lanes;
+              double *c_ij = c + (i * n + j) * lanes;
+              for (size_t lane = tile; lane < tile_end; lane++)
+                c_ij[lane] += alpha * a_ip[lane] * b_pj[lane];
+            }
+          }
+        }
+      }
+    }
+
+    // C = alpha A B + beta C for the matrices [begin, end) of strided batches
+    inline auto gemm_strided(size_t m, size_t n, size_t k, size_t begin, size_t end,
+                             double alpha, const double *a, const double *b, double beta, double *c) -> void
+    {
+      for (size_t index = begin; index < end; index++)
+      {
+        const double *a_k = a + index * m * k;
+        const double *b_k = b + index * k * n;
+        double *c_k = c + index * m * n;
+
+        for (size_t i = 0; i < m; i++)
+        {
+          double *c_i = c_k + i * n;
+          for (size_t j = 0; j < n; j++)
+            c_i[j] = beta == 0.0 ? 0.0 : beta * c_i[j];
+
+          for (size_t p = 0; p < k; p++)
+          {
+            const double a_ip = alpha * a_k[i * k + p];
+            const double *b_p = b_k + p * n;
+            for (size_t j = 0; j < n; j++)
+              c_i[j] += a_ip * b_p[j];
+          }
+        }
+      }
+    }
+
+    // Gaussian elimination with partial pivoting chosen per lane, the row
+    // operations run across the lanes [begin, end) of interleaved batches
+    inline auto lu_solve_interleaved(size_t n, size_t num_rhs, size_t lanes, size_t begin, size_t end,
+                                     double *a, double *x, std::vector<char> &singular) -> void
+    {
+      std::vector<size_t> pivot(batch_lane_tile);
+      std::vector<double> factor(batch_lane_tile);
+
+      for (size_t tile = begin; tile < end; tile += batch_lane_tile)
+      {
+        const size_t tile_end = std::min(tile + batch_lane_tile, end);
+
+        for (size_t k = 0; k < n; k++)
+        {
+          for (size_t lane = tile; lane < tile_end; lane++)
+          {
+            size_t best = k;
+            for (size_t i = k + 1; i < n; i++)
+            {
+              if (std::fabs(a[(i * n + k) * lanes + lane]) > std::fabs(a[(best * n + k) * lanes + lane]))
+                best = i;
+            }
+            if (a[(best * n + k) * lanes + lane] == 0.0)
+              singular[lane] = 1;
+            pivot[lane - tile] = best;
+          }
+
+          // Row swaps differ between lanes, so they go element by element
+          for (size_t lane = tile; lane < tile_end; lane++)
+          {
+            const size_t row = pivot[lane - tile];
+            if (row == k)
+              continue;
+            for (size_t j = 0; j < n; j++)
+              std::swap(a[(k * n + j) * lanes + lane], a[(row * n + j) * lanes + lane]);
+            for (size_t j = 0; j < num_rhs; j++)
+              std::swap(x[(k * num_rhs + j) * lanes + lane], x[(row * num_rhs + j) * lanes + lane]);
+          }
+
+          const double *a_kk = a + (k * n + k) * lanes;
+          for (size_t i = k + 1; i < n; i++)
+          {
+            double *a_ik = a + (i * n + k) * lanes;
+            for (size_t lane = tile; lane < tile_end; lane++)
+            {
+              a_ik[lane] = a_kk[lane] == 0.0 ? 0.0 : a_ik[lane] / a_kk[lane];
+              factor[lane - tile] = a_ik[lane];
+            }
+
+            for (size_t j = k + 1; j < n; j++)
+            {
+              const double *a_kj = a + (k * n + j) * lanes;
+              double *a_ij = a + (i * n + j) * lanes;
+              for (size_t lane = tile; lane < tile_end; lane++)
+                a_ij[lane] -= factor[lane - tile] * a_kj[lane];
+            }
+            for (size_t j = 0; j < num_rhs; j++)
+            {
+              const double *x_kj = x + (k * num_rhs + j) * lanes;
+              double *x_ij = x + (i * num_rhs + j) * lanes;
+              for (size_t lane = tile; lane < tile_end; lane++)
+                x_ij[lane] -= factor[lane - tile] * x_kj[lane];
+            }
+          }
+        }
+
+        // Back substitution with the upper triangular factor
+        for (size_t i = n; i-- > 0;)
+        {
+          const double *a_ii = a + (i * n + i) * lanes;
+          for (size_t j = 0; j < num_rhs; j++)
+          {
+            double *x_ij = x + (i * num_rhs + j) * lanes;
+            for (size_t p = i + 1; p < n; p++)
+            {
+              const double *a_ip = a + (i * n + p) * lanes;
+              const double *x_pj = x + (p * num_rhs + j) * lanes;
+              for (size_t lane = tile; lane < tile_end; lane++)
+                x_ij[lane] -= a_ip[lane] * x_pj[lane];
+            }
+            for (size_t lane = tile; lane < tile_end; lane++)
+              x_ij[lane] = a_ii[lane] == 0.0 ? 0.0 : x_ij[lane] / a_ii[lane];
+          }
+        }
+      }
+    }
+
+    // LU solves of the matrices [begin, end) of strided batches through GSL
+    inline auto lu_solve_strided(size_t n, size_t num_rhs, size_t begin, size_t end,
+                                 double *a, double *x, std::vector<char> &singular) -> void
+    {
+      std::unique_ptr<gsl_permutation, void (*)(gsl_permutation *)> permutation{gsl_permutation_alloc(n), gsl_permutation_free};
+
+      for (size_t index = begin; index < end; index++)
+      {
+        gsl_matrix_view lu = gsl_matrix_view_array(a + index * n * n, n, n);
+        gsl_matrix_view rhs = gsl_matrix_view_array(x + index * n * num_rhs, n, num_rhs);
+
+        int signum;
+        gsl_linalg_LU_decomp(&lu.matrix, permutation.get(), &signum);
+        for (size_t i = 0; i < n; i++)
+        {
+          if (gsl_matrix_get(&lu.matrix, i, i) == 0.0)
+            singular[index] = 1;
+        }
+        if (singular[index])
+          continue;
+
+        for (size_t j = 0; j < num_rhs; j++)
+        {
+          gsl_vector_view collumn = gsl_matrix_column(&rhs.matrix, j);
+          gsl_linalg_LU_svx(&lu.matrix, permutation.get(), &collumn.vector);
+        }
+      }
+    }
+  }
+
+  inline MatrixBatch::MatrixBatch(size_t count, size_t num_rows, size_t num_collumns, BatchLayout layout)
+      : m_count{count},
+        m_numRows{num_rows},
+        m_numCollumns{num_collumns},
+        m_layout{layout},
+        m_data(count * num_rows * num_collumns, 0.0)
+  {
+  }
+
+  inline auto MatrixBatch::count() const -> size_t
+  {
+    return m_count;
+  }
+
+  inline auto MatrixBatch::num_rows() const -> size_t
+  {
+    return m_numRows;
+  }
+
+  inline auto MatrixBatch::num_collumns() const -> size_t
+  {
+    return m_numCollumns;
+  }
+
+  inline auto MatrixBatch::layout() const -> BatchLayout
+  {
+    return m_layout;
+  }
+
+  inline auto MatrixBatch::data() -> double *
+  {
+    return m_data.data();
+  }
+
+  inline auto MatrixBatch::data() const -> const double *
+  {
+    return m_data.data();
+  }
+
+  inline auto MatrixBatch::offset(size_t index, size_t row, size_t collumn) const -> size_t
+  {
+    if (m_layout == BatchLayout::Strided)
+      return (index * m_numRows + row) * m_numCollumns + collumn;
+    return (row * m_numCollumns + collumn) * m_count + index;
+  }
+
+  inline auto MatrixBatch::operator()(size_t index, size_t row, size_t collumn) -> double &
+  {
+    if (index >= m_count || row >= m_numRows || collumn >= m_numCollumns)
+      throw std::range_error{"Accesing element outside of the batch"};
+    return m_data[offset(index, row, collumn)];
+  }
+
+  inline auto MatrixBatch::operator()(size_t index, size_t row, size_t collumn) const -> const double &
+  {
+    if (index >= m_count || row >= m_numRows || collumn >= m_numCollumns)
+      throw std::range_error{"Accesing element outside of the batch"};
+    return m_data[offset(index, row, collumn)];
+  }
+
+  inline auto MatrixBatch::get(size_t index) const -> Matrix
+  {
+    Matrix result(m_numRows, m_numCollumns);
+    gsl_matrix *matrix = result.get_gsl_matrix();
+    for (size_t i = 0; i < m_numRows; i++)
+    {
+      for (size_t j = 0; j < m_numCollumns; j++)
+        matrix->data[i * matrix->tda + j] = (*this)(index, i, j);
+    }
+    return result;
+  }
+
+  inline auto MatrixBatch::set(size_t index, const Matrix &matrix) -> void
+  {
+    if (matrix.num_rows() != m_numRows || matrix.num_collumns() != m_numCollumns)
+      throw std::range_error{"Matrix of diffrent shape than the batch"};
+
+    const gsl_matrix *source = matrix.get_gsl_matrix();
+    for (size_t i = 0; i < m_numRows; i++)
+    {
+      for (size_t j = 0; j < m_numCollumns; j++)
+        (*this)(index, i, j) = source->data[i * source->tda + j];
+    }
+  }
+
+  inline auto MatrixBatch::set_identity() -> void
+  {
+    std::fill(m_data.begin(), m_data.end(), 0.0);
+    for (size_t index = 0; index < m_count; index++)
+    {
+      for (size_t i = 0; i < std::min(m_numRows, m_numCollumns); i++)
+        m_data[offset(index, i, i)] = 1.0;
+    }
+  }
+
+  inline auto MatrixBatch::with_layout(BatchLayout layout) const -> MatrixBatch
+  {
+    MatrixBatch result(m_count, m_numRows, m_numCollumns, layout);
+    if (layout == m_layout)
+    {
+      result.m_data = m_data;
+      return result;
+    }
+
+    for (size_t index = 0; index < m_count; index++)
+    {
+      for (size_t i = 0; i < m_numRows; i++)
+      {
+        for (size_t j = 0; j < m_numCollumns; j++)
+          result.m_data[result.offset(index, i, j)] = m_data[offset(index, i, j)];
+      }
+    }
+    return result;
+  }
+
+  inline auto MatrixBatch::view(size_t index) -> gsl_matrix_view
+  {
+    if (m_layout != BatchLayout::Strided)
+      throw std::runtime_error{"Only matrices of a strided batch can be viewed"};
+    if (index >= m_count)
+      throw std::range_error{"Accesing matrix outside of the batch"};
+    return gsl_matrix_view_array(m_data.data() + index * m_numRows * m_numCollumns, m_numRows, m_numCollumns);
+  }
+
+  inline auto MatrixBatch::view(size_t index) const -> gsl_matrix_const_view
+  {
+    if (m_layout != BatchLayout::Strided)
+      throw std::runtime_error{"Only matrices of a strided batch can be viewed"};
+    if (index >= m_count)
+      throw std::range_error{"Accesing matrix outside of the batch"};
+    return gsl_matrix_const_view_array(m_data.data() + index * m_numRows * m_numCollumns, m_numRows, m_numCollumns);
+  }
+
+  // Elementwise kernels see the storage as one flat array, split in blocks
+  inline auto MatrixBatch::elementwise(const MatrixBatch &other, const std::function<void(double *, const double *, size_t)> &kernel) -> void
+  {
+    if (other.m_count != m_count || other.m_numRows != m_numRows || other.m_numCollumns != m_numCollumns || other.m_layout != m_layout)
+      throw std::range_error{"Batches of diffrent shape or layout"};
+
+    double *destination = m_data.data();
+    const double *source = other.m_data.data();
+    bits::for_batch(m_data.size(), 1, [destination, source, &kernel](size_t begin, size_t end)
+                    { kernel(destination + begin, source + begin, end - begin); });
+  }
+
+  inline auto MatrixBatch::operator+=(const MatrixBatch &other) -> MatrixBatch &
+  {
+    elementwise(other, [](double *destination, const double *source, size_t size)
+                {
+                  for (size_t i = 0; i < size; i++)
+                    destination[i] += source[i]; });
+    return *this;
+  }
+
+  inline auto MatrixBatch::operator-=(const MatrixBatch &other) -> MatrixBatch &
+  {
+    elementwise(other, [](double *destination, const double *source, size_t size)
+                {
+                  for (size_t i = 0; i < size; i++)
+                    destination[i] -= source[i]; });
+    return *this;
+  }
+
+  inline auto MatrixBatch::multiply_elements(const MatrixBatch &other) -> MatrixBatch &
+  {
+    elementwise(other, [](double *destination, const double *source, size_t size)
+                {
+                  for (size_t i = 0; i < size; i++)
+                    destination[i] *= source[i]; });
+    return *this;
+  }
+
+  inline auto MatrixBatch::operator*=(double number) -> MatrixBatch &
+  {
+    double *data = m_data.data();
+    bits::for_batch(m_data.size(), 1, [data, number](size_t begin, size_t end)
+                    {
+                      for (size_t i = begin; i < end; i++)
+                        data[i] *= number; });
+    return *this;
+  }
+
+  inline auto gemm(double alpha, const MatrixBatch &a, const MatrixBatch &b, double beta, MatrixBatch &c) -> void
+  {
+    if (a.count() != b.count() || a.count() != c.count() || a.num_collumns() != b.num_rows() ||
+        c.num_rows() != a.num_rows() || c.num_collumns() != b.num_collumns())
+      throw std::range_error{"Batches of diffrent sizes in gemm"};
+    if (a.layout() != c.layout() || b.layout() != c.layout())
+      throw std::range_error{"Batches of diffrent layouts in gemm"};
+    if (&c == &a || &c == &b)
+      throw std::runtime_error{"Output of batched gemm overlaps an input"};
+
+    const size_t m = a.num_rows();
+    const size_t n = b.num_collumns();
+    const size_t k = a.num_collumns();
+    const size_t lanes = a.count();
+    const double *a_data = a.data();
+    const double *b_data = b.data();
+    double *c_data = c.data();
+
+    if (c.layout() == BatchLayout::Interleaved)
+    {
+      bits::for_batch(lanes, m * n * k, [=](size_t begin, size_t end)
+                      { bits::gemm_interleaved(m, n, k, lanes, begin, end, alpha, a_data, b_data, beta, c_data); });
+      return;
+    }
+
+    bits::for_batch(lanes, m * n * k, [=](size_t begin, size_t end)
+                    { bits::gemm_strided(m, n, k, begin, end, alpha, a_data, b_data, beta, c_data); });
+  }
+
+  inline auto operator*(const MatrixBatch &a, const MatrixBatch &b) -> MatrixBatch
+  {
+    MatrixBatch result(a.count(), a.num_rows(), b.num_collumns(), a.layout());
+    gemm(1.0, a, b, 0.0, result);
+    return result;
+  }
+
+  inline auto lu_solve(MatrixBatch &a, MatrixBatch &b) -> void
+  {
+    if (a.num_rows() != a.num_collumns())
+      throw std::range_error{"Batched LU solve needs square matrices"};
+    if (a.count() != b.count() || a.num_rows() != b.num_rows())
+      throw std::range_error{"Batches of diffrent sizes in LU solve"};
+    if (a.layout() != b.layout())
+      throw std::range_error{"Batches of diffrent layouts in LU solve"};
+
+    const size_t n = a.num_rows();
+    const size_t num_rhs = b.num_collumns();
+    const size_t lanes = a.count();
+    double *a_data = a.data();
+    double *x_data = b.data();
+    std::vector<char> singular(lanes, 0);
+
+    if (a.layout() == BatchLayout::Interleaved)
+    {
+      bits::for_batch(lanes, n * n * (n + num_rhs), [&](size_t begin, size_t end)
+                      { bits::lu_solve_interleaved(n, num_rhs, lanes, begin, end, a_data, x_data, singular); });
+    }
+    else
+    {
+      bits::for_batch(lanes, n * n * (n + num_rhs), [&](size_t begin, size_t end)
+                      { bits::lu_solve_strided(n, num_rhs, begin, end, a_data, x_data, singular); });
+    }
+
+    if (std::find(singular.begin(), singular.end(), 1) != singular.end())
+      throw std::runtime_error{"Singular matrix in batched LU solve"};
+  }
+
+  inline auto inverse(const MatrixBatch &a) -> MatrixBatch
+  {
+    MatrixBatch lu = a;
+    MatrixBatch result(a.count(), a.num_rows(), a.num_collumns(), a.layout());
+    result.set_identity();
+    lu_solve(lu, result);
+    return result;
+  }
+}
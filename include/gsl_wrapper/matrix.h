@@ -5,21 +5,62 @@
 #include <exception>
 #include <iostream>
 #include <cmath>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
 
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_linalg.h>
 
+#include "bits/huge-pages.h"
+#include "bits/gemm.h"
 #include "bits/matrix-view.h"
+#include "bits/random.h"
+#include "bits/shared-storage.h"
+#include "bits/thread-pool.h"
 #include "utils/fcmp.h"
 #include "vector.h"
 
 namespace gsl_wrapper
 {
+  // How the storage of a new matrix is obtained
+  enum class Allocation
+  {
+    // gsl_matrix_calloc on the calling thread
+    Standard,
+    // Huge page backed mapping zeroed in parallel row blocks, for large
+    // matrices. Cuts TLB misses and page fault time, pages are not placed
+    // on the NUMA node of the threads that later use them.
+    HugePages
+  };
+
+  class Matrix;
+
+  namespace bits
+  {
+    // Block of Matrix::block and the stacking functions, binds to
+    // temporaries as well, which live until the assembly is done
+    class MatrixRef
+    {
+    public:
+      MatrixRef(const Matrix &matrix);
+
+      auto get() const -> const Matrix &;
+
+    private:
+      const Matrix *m_matrix;
+    };
+  }
+
   class Matrix
   {
   public:
     // Constructors and destructor
     Matrix(size_t i, size_t j);
+    Matrix(size_t i, size_t j, Allocation allocation);
     Matrix(size_t matrix_size);
     Matrix(std::initializer_list<std::initializer_list<double>> args);
     Matrix(const Vector &vec);
@@ -29,12 +70,44 @@ namespace gsl_wrapper
 
     ~Matrix();
 
+    // Views row-major data owned elsewhere without copying it, with rows tda
+    // elements apart. The data has to outlive the matrix and copies of the
+    // view own their data again. Assigning to a view rebinds it to data of
+    // its own and never writes through.
+    static auto view(double *data, size_t num_rows, size_t num_collumns) -> Matrix;
+    static auto view(double *data, size_t num_rows, size_t num_collumns, size_t tda) -> Matrix;
+
+    // Assembles {{A, B}, {C, D}} with one allocation and row copies. Blocks in
+    // a block row need the same number of rows and every block row the same
+    // total number of collumns.
+    static auto block(std::initializer_list<std::initializer_list<bits::MatrixRef>> blocks) -> Matrix;
+
     // Member functions
+    auto get_gsl_matrix() -> gsl_matrix *;
     auto get_gsl_matrix() const -> gsl_matrix *;
     auto get_dimensions() const -> std::pair<size_t, size_t>;
     auto num_rows() const -> size_t;
     auto num_collumns() const -> size_t;
 
+    // Random fills, element (i, j) is number i * num_collumns() + j of the
+    // sequence and depends only on the seed, whatever the number of threads
+    auto fill_uniform(std::uint64_t seed, double lower = 0.0, double upper = 1.0) -> void;
+    auto fill_gaussian(std::uint64_t seed, double mean = 0.0, double sigma = 1.0) -> void;
+    auto fill_exponential(std::uint64_t seed, double mean = 1.0) -> void;
+    auto fill_lognormal(std::uint64_t seed, double zeta = 0.0, double sigma = 1.0) -> void;
+
+    // Copies share data until one of them is modified, and assigning to a
+    // copy on write matrix keeps it copy on write
+    //
+    // Sharing is not thread safe. Whether to copy before writing is decided
+    // from the reference count alone, so matrices sharing data must not be
+    // modified from different threads without synchronisation. Rows and
+    // pointers taken before a copy still point at the shared data, take
+    // them again after copying.
+    auto enable_copy_on_write() -> void;
+    auto is_copy_on_write() const -> bool;
+    auto shares_storage() const -> bool;
+
     // Operators
     auto operator=(const Matrix &copy_from) -> Matrix &;
     auto operator=(Matrix &&move_from) -> Matrix &;
@@ -42,7 +115,8 @@ namespace gsl_wrapper
     auto operator==(const Matrix &comparasion_matrix) const -> bool;
     auto operator!=(const Matrix &comparasion_matrix) const -> bool;
 
-    auto operator[](const size_t index) const -> gsl_wrapper::bits::MatrixRow;
+    auto operator[](const size_t index) -> gsl_wrapper::bits::MatrixRow;
+    auto operator[](const size_t index) const -> gsl_wrapper::bits::ConstMatrixRow;
     auto operator*(const Matrix &mul) const -> Matrix;
     auto operator*(const double number) const -> Matrix;
     auto operator+(const Matrix &matrix) const -> Matrix;
@@ -54,16 +128,52 @@ namespace gsl_wrapper
     friend auto operator+(const double number, const Matrix &matrix) -> Matrix;
 
   private:
+    Matrix(const gsl_matrix &header);
+
+    // Storage management
+    auto uses_header() const -> bool;
+    auto release() -> void;
+    auto take_storage(Matrix &move_from) -> void;
+    auto share_storage(const Matrix &copy_from) -> bool;
+    auto detach() -> void;
+
     gsl_matrix *m_matrixPtr;
     size_t m_numRows;
     size_t m_numCollumns;
+
+    // Matrices whose data is not owned by a gsl_block point m_matrixPtr at
+    // this header, m_storage keeps that data alive
+    gsl_matrix m_header;
+    std::shared_ptr<double> m_storage;
+    bool m_copyOnWrite = false;
   };
 
+  // Matrices side by side and one below the other
+  auto hstack(std::initializer_list<bits::MatrixRef> blocks) -> Matrix;
+  auto vstack(std::initializer_list<bits::MatrixRef> blocks) -> Matrix;
+
+  // Kronecker product, block (i, j) of the result is a[i][j] * b
+  auto kron(const Matrix &a, const Matrix &b) -> Matrix;
+
   inline Matrix::Matrix(size_t i, size_t j)
       : m_matrixPtr{gsl_matrix_calloc(i, j)}, m_numRows{i}, m_numCollumns{j}
   {
   }
 
+  inline Matrix::Matrix(size_t i, size_t j, Allocation allocation)
+      : m_matrixPtr{nullptr}, m_numRows{i}, m_numCollumns{j}
+  {
+    if (allocation == Allocation::Standard || i == 0 || j == 0)
+    {
+      m_matrixPtr = gsl_matrix_calloc(i, j);
+      return;
+    }
+
+    m_storage = bits::allocate_zeroed_huge_pages(i, j, bits::ThreadPool::shared());
+    m_header = gsl_matrix{i, j, j, m_storage.get(), nullptr, 0};
+    m_matrixPtr = &m_header;
+  }
+
   inline Matrix::Matrix(size_t matrix_size)
       : Matrix(matrix_size, matrix_size)
   {
@@ -109,26 +219,148 @@ namespace gsl_wrapper
     }
   }
 
+  inline Matrix::Matrix(const gsl_matrix &header)
+      : m_matrixPtr{&m_header},
+        m_numRows{header.size1},
+        m_numCollumns{header.size2},
+        m_header{header}
+  {
+  }
+
+  inline auto Matrix::view(double *data, size_t num_rows, size_t num_collumns) -> Matrix
+  {
+    return view(data, num_rows, num_collumns, num_collumns);
+  }
+
+  inline auto Matrix::view(double *data, size_t num_rows, size_t num_collumns, size_t tda) -> Matrix
+  {
+    if (tda < num_collumns)
+      throw std::range_error{"Matrix view with rows shorter than the number of collumns"};
+    return Matrix(gsl_matrix{num_rows, num_collumns, tda, data, nullptr, 0});
+  }
+
   inline Matrix::Matrix(const Matrix &copy_from)
-      : m_matrixPtr{gsl_matrix_calloc(copy_from.m_numRows, copy_from.m_numCollumns)},
+      : m_matrixPtr{nullptr},
         m_numRows{copy_from.m_numRows},
         m_numCollumns{copy_from.m_numCollumns}
   {
+    if (share_storage(copy_from))
+      return;
+
+    m_matrixPtr = gsl_matrix_calloc(m_numRows, m_numCollumns);
     gsl_matrix_memcpy(m_matrixPtr, copy_from.m_matrixPtr);
+    if (copy_from.m_copyOnWrite)
+      enable_copy_on_write();
   }
 
   inline Matrix::Matrix(Matrix &&move_from)
-      : m_matrixPtr{std::exchange(move_from.m_matrixPtr, nullptr)},
-        m_numRows{std::exchange(move_from.m_numRows, 0)},
-        m_numCollumns{std::exchange(move_from.m_numCollumns, 0)}
+      : m_matrixPtr{nullptr},
+        m_numRows{0},
+        m_numCollumns{0}
   {
+    take_storage(move_from);
   }
 
   inline Matrix::~Matrix()
   {
-    gsl_matrix_free(m_matrixPtr);
+    release();
+  }
+
+  inline auto Matrix::uses_header() const -> bool
+  {
+    return m_matrixPtr == &m_header;
+  }
+
+  inline auto Matrix::release() -> void
+  {
+    if (!uses_header())
+      gsl_matrix_free(m_matrixPtr);
+    m_matrixPtr = nullptr;
+    m_storage.reset();
+  }
+
+  inline auto Matrix::take_storage(Matrix &move_from) -> void
+  {
+    m_numRows = std::exchange(move_from.m_numRows, 0);
+    m_numCollumns = std::exchange(move_from.m_numCollumns, 0);
+    m_storage = std::move(move_from.m_storage);
+    m_copyOnWrite = move_from.m_copyOnWrite;
+
+    // The header lives inside the object, so it is copied instead of handed over
+    if (move_from.uses_header())
+    {
+      m_header = move_from.m_header;
+      m_matrixPtr = &m_header;
+      move_from.m_matrixPtr = nullptr;
+      return;
+    }
+
+    m_matrixPtr = std::exchange(move_from.m_matrixPtr, nullptr);
+  }
+
+  inline auto Matrix::share_storage(const Matrix &copy_from) -> bool
+  {
+    if (!copy_from.m_copyOnWrite || !copy_from.m_storage)
+      return false;
+
+    m_header = copy_from.m_header;
+    m_storage = copy_from.m_storage;
+    m_matrixPtr = &m_header;
+    m_numRows = copy_from.m_numRows;
+    m_numCollumns = copy_from.m_numCollumns;
+    m_copyOnWrite = true;
+    return true;
+  }
+
+  inline auto Matrix::detach() -> void
+  {
+    if (!m_storage || m_storage.use_count() == 1)
+      return;
+
+    // Someone else still reads the shared data, so this matrix gets its own copy
+    auto storage = bits::allocate_block(m_numRows * m_numCollumns);
+    gsl_matrix copy{m_numRows, m_numCollumns, m_numCollumns, storage.get(), nullptr, 0};
+    gsl_matrix_memcpy(&copy, &m_header);
+
+    m_header = copy;
+    m_storage = std::move(storage);
+  }
+
+  inline auto Matrix::enable_copy_on_write() -> void
+  {
+    m_copyOnWrite = true;
+    if (m_matrixPtr == nullptr || uses_header())
+      return;
+
+    // Handing the gsl_block over to reference counted storage
+    gsl_matrix *owned = m_matrixPtr;
+    if (owned->owner)
+    {
+      m_storage = bits::adopt_block(owned->block, owned->data);
+      owned->owner = 0;
+    }
+    m_header = gsl_matrix{owned->size1, owned->size2, owned->tda, owned->data, nullptr, 0};
+    m_matrixPtr = &m_header;
+    gsl_matrix_free(owned);
+  }
+
+  inline auto Matrix::is_copy_on_write() const -> bool
+  {
+    return m_copyOnWrite;
+  }
+
+  inline auto Matrix::shares_storage() const -> bool
+  {
+    return m_storage && m_storage.use_count() > 1;
+  }
+
+  inline auto Matrix::get_gsl_matrix() -> gsl_matrix *
+  {
+    detach();
+    return m_matrixPtr;
   }
 
+  // Writing through the pointer of a const matrix bypasses copy on write
   inline auto Matrix::get_gsl_matrix() const -> gsl_matrix *
   {
     return m_matrixPtr;
@@ -148,19 +380,59 @@ namespace gsl_wrapper
     return m_numCollumns;
   }
 
+  inline auto Matrix::fill_uniform(std::uint64_t seed, double lower, double upper) -> void
+  {
+    if (m_matrixPtr == nullptr)
+      return;
+    gsl_matrix *matrix = get_gsl_matrix();
+    bits::random_fill_rows(seed, bits::RandomDistribution::Uniform, m_numRows, m_numCollumns, matrix->data, matrix->tda, 1, bits::uniform_pair(lower, upper));
+  }
+
+  inline auto Matrix::fill_gaussian(std::uint64_t seed, double mean, double sigma) -> void
+  {
+    if (m_matrixPtr == nullptr)
+      return;
+    gsl_matrix *matrix = get_gsl_matrix();
+    bits::random_fill_rows(seed, bits::RandomDistribution::Gaussian, m_numRows, m_numCollumns, matrix->data, matrix->tda, 1, bits::gaussian_pair(mean, sigma));
+  }
+
+  inline auto Matrix::fill_exponential(std::uint64_t seed, double mean) -> void
+  {
+    if (m_matrixPtr == nullptr)
+      return;
+    gsl_matrix *matrix = get_gsl_matrix();
+    bits::random_fill_rows(seed, bits::RandomDistribution::Exponential, m_numRows, m_numCollumns, matrix->data, matrix->tda, 1, bits::exponential_pair(mean));
+  }
+
+  inline auto Matrix::fill_lognormal(std::uint64_t seed, double zeta, double sigma) -> void
+  {
+    if (m_matrixPtr == nullptr)
+      return;
+    gsl_matrix *matrix = get_gsl_matrix();
+    bits::random_fill_rows(seed, bits::RandomDistribution::Lognormal, m_numRows, m_numCollumns, matrix->data, matrix->tda, 1, bits::lognormal_pair(zeta, sigma));
+  }
+
   inline auto Matrix::operator=(const Matrix &copy_from) -> Matrix &
   {
     // Prevent self copy
     if (m_matrixPtr == copy_from.m_matrixPtr)
       return *this;
 
-    gsl_matrix_free(m_matrixPtr);
+    const bool copy_on_write = m_copyOnWrite || copy_from.m_copyOnWrite;
+    release();
+    if (share_storage(copy_from))
+      return *this;
+
     m_matrixPtr = gsl_matrix_calloc(copy_from.m_numRows, copy_from.m_numCollumns);
     gsl_matrix_memcpy(m_matrixPtr, copy_from.m_matrixPtr);
 
     m_numCollumns = copy_from.m_numCollumns;
     m_numRows = copy_from.m_numRows;
 
+    m_copyOnWrite = copy_on_write;
+    if (m_copyOnWrite)
+      enable_copy_on_write();
+
     return *this;
   }
 
@@ -170,44 +442,72 @@ namespace gsl_wrapper
     if (m_matrixPtr == move_from.m_matrixPtr)
       return *this;
 
-    gsl_matrix_free(m_matrixPtr);
-    m_matrixPtr = std::exchange(move_from.m_matrixPtr, nullptr);
-    m_numRows = std::exchange(move_from.m_numRows, 0);
-    m_numCollumns = std::exchange(move_from.m_numCollumns, 0);
+    release();
+    take_storage(move_from);
 
     return *this;
   }
 
-  inline auto Matrix::operator==(const Matrix &comparasion_matrix) const -> bool
+  // Elementwise comparison, elements match within rtol * max(|a|, |b|) + atol or `ulps` units in the last place
+  inline auto approx_equal(const Matrix &first, const Matrix &second,
+                           const double rtol = std::numeric_limits<double>::epsilon(),
+                           const double atol = 0.0, const std::uint64_t ulps = 0) -> bool
   {
-
-    if ((m_numCollumns != comparasion_matrix.m_numCollumns) || (m_numRows != comparasion_matrix.m_numRows))
+    if (first.get_dimensions() != second.get_dimensions())
       return false;
 
-    for (size_t i = 0; i < m_numRows; i++)
+    const gsl_matrix *m1 = first.get_gsl_matrix();
+    const gsl_matrix *m2 = second.get_gsl_matrix();
+    for (size_t i = 0; i < first.num_rows(); i++)
     {
-      for (size_t j = 0; j < m_numCollumns; j++)
-      {
-        bool test = ::gsl_wrapper::utils::equal((*this)[i][j], comparasion_matrix[i][j]);
-        if (!test)
-          return false;
-      }
+      if (!::gsl_wrapper::utils::approx_equal_n(m1->data + i * m1->tda, 1, m2->data + i * m2->tda, 1, first.num_collumns(), rtol, atol, ulps))
+        return false;
     }
     return true;
   }
 
+  // Largest absolute, relative and ulp differences in a single pass
+  inline auto compare(const Matrix &first, const Matrix &second) -> ::gsl_wrapper::utils::Comparison
+  {
+    if (first.get_dimensions() != second.get_dimensions())
+      throw std::range_error{"Comparing matrices of diffrent sizes"};
+
+    ::gsl_wrapper::utils::Comparison result{0.0, 0.0, 0, 0};
+    const gsl_matrix *m1 = first.get_gsl_matrix();
+    const gsl_matrix *m2 = second.get_gsl_matrix();
+    const size_t num_collumns = first.num_collumns();
+    for (size_t i = 0; i < first.num_rows(); i++)
+    {
+      ::gsl_wrapper::utils::compare_n(m1->data + i * m1->tda, 1, m2->data + i * m2->tda, 1, num_collumns, i * num_collumns, result);
+    }
+    return result;
+  }
+
+  inline auto Matrix::operator==(const Matrix &comparasion_matrix) const -> bool
+  {
+    return approx_equal(*this, comparasion_matrix);
+  }
+
   inline auto Matrix::operator!=(const Matrix &comparasion_matrix) const -> bool
   {
     return !(*this == comparasion_matrix);
   }
 
-  inline auto Matrix::operator[](const size_t index) const -> gsl_wrapper::bits::MatrixRow
+  inline auto Matrix::operator[](const size_t index) -> gsl_wrapper::bits::MatrixRow
   {
     using bits::MatrixRow;
+    detach();
     gsl_vector_view view = gsl_matrix_row(m_matrixPtr, index);
     return MatrixRow(view);
   }
 
+  inline auto Matrix::operator[](const size_t index) const -> gsl_wrapper::bits::ConstMatrixRow
+  {
+    using bits::ConstMatrixRow;
+    gsl_vector_const_view view = gsl_matrix_const_row(m_matrixPtr, index);
+    return ConstMatrixRow(view);
+  }
+
   inline auto Matrix::operator*(const Matrix &mul) const -> Matrix
   {
     // Check sizes
@@ -215,7 +515,7 @@ namespace gsl_wrapper
       throw std::runtime_error{"Wrong matrix sizes!"};
 
     Matrix result(m_numRows, mul.m_numCollumns);
-    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0, m_matrixPtr, mul.m_matrixPtr, 0.0, result.get_gsl_matrix());
+    bits::dgemm(CblasNoTrans, CblasNoTrans, 1.0, m_matrixPtr, mul.m_matrixPtr, 0.0, result.get_gsl_matrix());
 
     return result;
   }
@@ -240,7 +540,7 @@ namespace gsl_wrapper
       throw std::range_error{"Wrong matrix sizes when adding"};
 
     Matrix result = *this;
-    gsl_matrix_add(result.m_matrixPtr, matrix.m_matrixPtr);
+    gsl_matrix_add(result.get_gsl_matrix(), matrix.m_matrixPtr);
 
     return result;
   }
@@ -300,4 +600,154 @@ namespace gsl_wrapper
 
     return result;
   }
+
+  namespace bits
+  {
+    // Assemblies with fewer elements than this are copied on the calling thread
+    constexpr size_t assembly_parallel_threshold = size_t{1} << 18;
+
+    inline MatrixRef::MatrixRef(const Matrix &matrix)
+        : m_matrix{&matrix}
+    {
+    }
+
+    inline auto MatrixRef::get() const -> const Matrix &
+    {
+      return *m_matrix;
+    }
+
+    // Sizes the result once and copies it together row by row, each output
+    // row taking one memcpy per block it crosses
+    inline auto assemble_blocks(const std::vector<std::vector<const Matrix *>> &blocks) -> Matrix
+    {
+      std::vector<size_t> first_row;
+      size_t num_rows = 0;
+      size_t num_collumns = 0;
+      for (size_t block_row = 0; block_row < blocks.size(); block_row++)
+      {
+        if (blocks[block_row].empty())
+          throw std::range_error{"Empty block row when assembling a matrix"};
+
+        const size_t height = blocks[block_row].front()->num_rows();
+        size_t width = 0;
+        for (const Matrix *block : blocks[block_row])
+        {
+          if (block->num_rows() != height)
+            throw std::range_error{"Blocks with diffrent number of rows in one block row"};
+          width += block->num_collumns();
+        }
+        if (block_row > 0 && width != num_collumns)
+          throw std::range_error{"Block rows with diffrent number of collumns"};
+
+        first_row.push_back(num_rows);
+        num_rows += height;
+        num_collumns = width;
+      }
+      if (num_rows == 0 || num_collumns == 0)
+        throw std::range_error{"Assembling an empty matrix"};
+
+      Matrix result(num_rows, num_collumns);
+      gsl_matrix *target = result.get_gsl_matrix();
+
+      auto body = [&](size_t begin, size_t end)
+      {
+        size_t block_row = std::upper_bound(first_row.begin(), first_row.end(), begin) - first_row.begin() - 1;
+        for (size_t row = begin; row < end; row++)
+        {
+          while (block_row + 1 < first_row.size() && row >= first_row[block_row + 1])
+            block_row++;
+
+          double *destination = target->data + row * target->tda;
+          for (const Matrix *block : blocks[block_row])
+          {
+            const gsl_matrix *source = block->get_gsl_matrix();
+            if (source == nullptr)
+              continue;
+            std::memcpy(destination, source->data + (row - first_row[block_row]) * source->tda, source->size2 * sizeof(double));
+            destination += source->size2;
+          }
+        }
+      };
+
+      if (num_rows * num_collumns < assembly_parallel_threshold)
+        body(0, num_rows);
+      else
+        ThreadPool::shared().parallel_for(num_rows, body);
+
+      return result;
+    }
+  }
+
+  inline auto Matrix::block(std::initializer_list<std::initializer_list<bits::MatrixRef>> blocks) -> Matrix
+  {
+    std::vector<std::vector<const Matrix *>> pointers;
+    pointers.reserve(blocks.size());
+    for (auto &&block_row : blocks)
+    {
+      pointers.emplace_back();
+      for (auto &&block : block_row)
+      {
+        pointers.back().push_back(&block.get());
+      }
+    }
+    return bits::assemble_blocks(pointers);
+  }
+
+  inline auto hstack(std::initializer_list<bits::MatrixRef> blocks) -> Matrix
+  {
+    std::vector<std::vector<const Matrix *>> pointers(1);
+    for (auto &&block : blocks)
+    {
+      pointers[0].push_back(&block.get());
+    }
+    return bits::assemble_blocks(pointers);
+  }
+
+  inline auto vstack(std::initializer_list<bits::MatrixRef> blocks) -> Matrix
+  {
+    std::vector<std::vector<const Matrix *>> pointers;
+    for (auto &&block : blocks)
+    {
+      pointers.push_back({&block.get()});
+    }
+    return bits::assemble_blocks(pointers);
+  }
+
+  inline auto kron(const Matrix &a, const Matrix &b) -> Matrix
+  {
+    const size_t b_rows = b.num_rows();
+    const size_t b_collumns = b.num_collumns();
+    if (a.num_rows() == 0 || a.num_collumns() == 0 || b_rows == 0 || b_collumns == 0)
+      throw std::range_error{"Kronecker product of an empty matrix"};
+
+    Matrix result(a.num_rows() * b_rows, a.num_collumns() * b_collumns);
+    const gsl_matrix *left = a.get_gsl_matrix();
+    const gsl_matrix *right = b.get_gsl_matrix();
+    gsl_matrix *target = result.get_gsl_matrix();
+
+    // Output row (i, k) is row i of a with every element scaling row k of b
+    auto body = [=](size_t begin, size_t end)
+    {
+      for (size_t row = begin; row < end; row++)
+      {
+        const double *a_i = left->data + (row / b_rows) * left->tda;
+        const double *b_k = right->data + (row % b_rows) * right->tda;
+        double *destination = target->data + row * target->tda;
+        for (size_t j = 0; j < left->size2; j++)
+        {
+          const double a_ij = a_i[j];
+          double *destination_j = destination + j * b_collumns;
+          for (size_t l = 0; l < b_collumns; l++)
+            destination_j[l] = a_ij * b_k[l];
+        }
+      }
+    };
+
+    if (target->size1 * target->size2 < bits::assembly_parallel_threshold)
+      body(0, target->size1);
+    else
+      bits::ThreadPool::shared().parallel_for(target->size1, body);
+
+    return result;
+  }
 }
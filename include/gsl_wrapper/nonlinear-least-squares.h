@@ -0,0 +1,327 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <gsl/gsl_blas.h>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_multifit_nlinear.h>
+
+#include "bits/callbacks.h"
+#include "bits/error-handler.h"
+#include "matrix.h"
+#include "vector.h"
+
+namespace gsl_wrapper
+{
+  // Residuals f(x) of a least squares problem min |f(x)|^2 and their Jacobian
+  //
+  // parameters, residuals and jacobian alias the solver's workspace for the
+  // duration of one call. Without a Jacobian GSL approximates it by finite
+  // differences, calling residual once more per parameter. fit_batch shares
+  // a model between threads, so it must not mutate state of its own.
+  class LeastSquaresModel
+  {
+  public:
+    using Residual = std::function<void(const Vector &parameters, Vector &residuals)>;
+    using Jacobian = std::function<void(const Vector &parameters, Matrix &jacobian)>;
+
+    // Constructors
+    LeastSquaresModel(size_t num_residuals, size_t num_parameters, Residual residual, Jacobian jacobian = nullptr);
+
+    // Member functions
+    auto num_residuals() const -> size_t;
+    auto num_parameters() const -> size_t;
+    auto has_jacobian() const -> bool;
+    auto residual(const Vector &parameters, Vector &residuals) const -> void;
+    auto jacobian(const Vector &parameters, Matrix &jacobian) const -> void;
+
+  private:
+    size_t m_num_residuals;
+    size_t m_num_parameters;
+    Residual m_residual;
+    Jacobian m_jacobian;
+  };
+
+  enum class TrustRegion
+  {
+    // gsl_multifit_nlinear_trs_lm, lmaccel, dogleg, ddogleg and subspace2D
+    LevenbergMarquardt,
+    LevenbergMarquardtAccelerated,
+    Dogleg,
+    DoubleDogleg,
+    Subspace2D
+  };
+
+  struct LeastSquaresSettings
+  {
+    TrustRegion method = TrustRegion::LevenbergMarquardt;
+    size_t max_iterations = 100;
+    // Stopping tests of gsl_multifit_nlinear_test, the gradient tolerance
+    // is the cube root of the machine epsilon suggested by GSL
+    double step_tolerance = 1e-8;
+    double gradient_tolerance = 6.0554544523933e-06;
+    double cost_tolerance = 0.0;
+  };
+
+  struct FitResult
+  {
+    size_t iterations;
+    double residual_norm;
+    bool converged;
+  };
+
+  namespace bits
+  {
+    using LeastSquaresCallbacks = CallbackState<LeastSquaresModel>;
+
+    inline auto least_squares_residual(const gsl_vector *x, void *params, gsl_vector *f) -> int
+    {
+      return static_cast<LeastSquaresCallbacks *>(params)->call([&](const LeastSquaresModel &model)
+                                                                {
+                                                                  const Vector parameters = Vector::view(x->data, x->size, x->stride);
+                                                                  Vector residuals = Vector::view(f->data, f->size, f->stride);
+                                                                  model.residual(parameters, residuals); });
+    }
+
+    inline auto least_squares_jacobian(const gsl_vector *x, void *params, gsl_matrix *J) -> int
+    {
+      return static_cast<LeastSquaresCallbacks *>(params)->call([&](const LeastSquaresModel &model)
+                                                                {
+                                                                  const Vector parameters = Vector::view(x->data, x->size, x->stride);
+                                                                  Matrix jacobian = Matrix::view(J->data, J->size1, J->size2, J->tda);
+                                                                  model.jacobian(parameters, jacobian); });
+    }
+
+    inline auto trust_region_subproblem(TrustRegion method) -> const gsl_multifit_nlinear_trs *
+    {
+      switch (method)
+      {
+      case TrustRegion::LevenbergMarquardt:
+        return gsl_multifit_nlinear_trs_lm;
+      case TrustRegion::LevenbergMarquardtAccelerated:
+        return gsl_multifit_nlinear_trs_lmaccel;
+      case TrustRegion::Dogleg:
+        return gsl_multifit_nlinear_trs_dogleg;
+      case TrustRegion::DoubleDogleg:
+        return gsl_multifit_nlinear_trs_ddogleg;
+      case TrustRegion::Subspace2D:
+        return gsl_multifit_nlinear_trs_subspace2D;
+      }
+      throw std::runtime_error{"Unknown trust region method"};
+    }
+
+    struct MultifitNlinearFree
+    {
+      auto operator()(gsl_multifit_nlinear_workspace *workspace) const -> void
+      {
+        gsl_multifit_nlinear_free(workspace);
+      }
+    };
+  }
+
+  // Trust region solver for problems of one shape on top of
+  // gsl_multifit_nlinear
+  //
+  // The workspace is allocated once, any number of models with the same
+  // numbers of residuals and parameters can be fitted one after the other.
+  class NonlinearLeastSquares
+  {
+  public:
+    // Constructors
+    NonlinearLeastSquares(size_t num_residuals, size_t num_parameters, LeastSquaresSettings settings = {});
+
+    // Member functions
+    auto num_residuals() const -> size_t;
+    auto num_parameters() const -> size_t;
+    auto settings() const -> const LeastSquaresSettings &;
+
+    // Starts from the given parameters and leaves the best fit in them
+    auto fit(const LeastSquaresModel &model, Vector &parameters) -> FitResult;
+
+    // Covariance of the parameters of the last fit from its Jacobian,
+    // dropping directions with singular values below epsrel times the largest
+    auto covariance(double epsrel = 0.0) const -> Matrix;
+
+  private:
+    LeastSquaresSettings m_settings;
+    // gsl_multifit_nlinear_init keeps a pointer to *m_fdf in the workspace
+    // and m_fdf->params points at *m_callbacks
+    std::unique_ptr<bits::LeastSquaresCallbacks> m_callbacks;
+    std::unique_ptr<gsl_multifit_nlinear_fdf> m_fdf;
+    std::unique_ptr<gsl_multifit_nlinear_workspace, bits::MultifitNlinearFree> m_workspace;
+    bool m_fitted = false;
+  };
+
+  // Fits every row of parameters in place, with one model for all rows or
+  // models[i] for row i, splitting the rows between the threads of the
+  // shared pool. Each thread reuses one workspace for its fits.
+  auto fit_batch(const LeastSquaresModel &model, Matrix &parameters, LeastSquaresSettings settings = {}) -> std::vector<FitResult>;
+  auto fit_batch(const std::vector<LeastSquaresModel> &models, Matrix &parameters, LeastSquaresSettings settings = {}) -> std::vector<FitResult>;
+
+  inline LeastSquaresModel::LeastSquaresModel(size_t num_residuals, size_t num_parameters, Residual residual, Jacobian jacobian)
+      : m_num_residuals{num_residuals},
+        m_num_parameters{num_parameters},
+        m_residual{std::move(residual)},
+        m_jacobian{std::move(jacobian)}
+  {
+    if (m_num_parameters == 0 || m_num_residuals < m_num_parameters)
+      throw std::range_error{"Least squares needs at least as many residuals as parameters"};
+    if (!m_residual)
+      throw std::runtime_error{"Least squares model without residuals"};
+  }
+
+  inline auto LeastSquaresModel::num_residuals() const -> size_t
+  {
+    return m_num_residuals;
+  }
+
+  inline auto LeastSquaresModel::num_parameters() const -> size_t
+  {
+    return m_num_parameters;
+  }
+
+  inline auto LeastSquaresModel::has_jacobian() const -> bool
+  {
+    return static_cast<bool>(m_jacobian);
+  }
+
+  inline auto LeastSquaresModel::residual(const Vector &parameters, Vector &residuals) const -> void
+  {
+    m_residual(parameters, residuals);
+  }
+
+  inline auto LeastSquaresModel::jacobian(const Vector &parameters, Matrix &jacobian) const -> void
+  {
+    if (!m_jacobian)
+      throw std::runtime_error{"Least squares model without a Jacobian"};
+    m_jacobian(parameters, jacobian);
+  }
+
+  inline NonlinearLeastSquares::NonlinearLeastSquares(size_t num_residuals, size_t num_parameters, LeastSquaresSettings settings)
+      : m_settings{settings},
+        m_callbacks{std::make_unique<bits::LeastSquaresCallbacks>()},
+        m_fdf{std::make_unique<gsl_multifit_nlinear_fdf>()}
+  {
+    // gsl_multifit_nlinear_alloc reports these through the GSL error handler
+    if (num_parameters == 0 || num_residuals < num_parameters)
+      throw std::range_error{"Least squares needs at least as many residuals as parameters"};
+
+    gsl_multifit_nlinear_parameters parameters = gsl_multifit_nlinear_default_parameters();
+    parameters.trs = bits::trust_region_subproblem(settings.method);
+    m_workspace.reset(gsl_multifit_nlinear_alloc(gsl_multifit_nlinear_trust, &parameters, num_residuals, num_parameters));
+    if (!m_workspace)
+      throw std::runtime_error{"Failed to allocate the least squares workspace"};
+
+    m_fdf->f = bits::least_squares_residual;
+    m_fdf->df = nullptr;
+    m_fdf->fvv = nullptr;
+    m_fdf->n = num_residuals;
+    m_fdf->p = num_parameters;
+    m_fdf->params = m_callbacks.get();
+  }
+
+  inline auto NonlinearLeastSquares::num_residuals() const -> size_t
+  {
+    return m_fdf->n;
+  }
+
+  inline auto NonlinearLeastSquares::num_parameters() const -> size_t
+  {
+    return m_fdf->p;
+  }
+
+  inline auto NonlinearLeastSquares::settings() const -> const LeastSquaresSettings &
+  {
+    return m_settings;
+  }
+
+  inline auto NonlinearLeastSquares::fit(const LeastSquaresModel &model, Vector &parameters) -> FitResult
+  {
+    if (model.num_residuals() != num_residuals() || model.num_parameters() != num_parameters() || parameters.size() != num_parameters())
+      throw std::range_error{"Diffrent shapes of least squares model, solver and parameters"};
+
+    m_callbacks->start(model);
+    m_fdf->df = model.has_jacobian() ? bits::least_squares_jacobian : nullptr;
+    m_fitted = false;
+
+    // gsl_multifit_nlinear_driver folds the status of a failed iteration
+    // into its convergence test and goes on iterating, so the loop is ours:
+    // it stops at the first error, thrown or returned
+    bits::ErrorHandlerOff errors;
+    int status = gsl_multifit_nlinear_init(parameters.get_gsl_vector(), m_fdf.get(), m_workspace.get());
+    bool converged = false;
+    for (size_t iteration = 0; status == GSL_SUCCESS && !converged && iteration < m_settings.max_iterations; iteration++)
+    {
+      status = gsl_multifit_nlinear_iterate(m_workspace.get());
+      if (status != GSL_SUCCESS || m_callbacks->error)
+        break;
+
+      int info = 0;
+      converged = gsl_multifit_nlinear_test(m_settings.step_tolerance, m_settings.gradient_tolerance, m_settings.cost_tolerance, &info,
+                                            m_workspace.get()) == GSL_SUCCESS;
+    }
+
+    m_callbacks->finish();
+    // Running out of progress still leaves the best point found
+    if (status != GSL_SUCCESS && status != GSL_ENOPROG)
+      throw std::runtime_error{gsl_strerror(status)};
+
+    m_fitted = true;
+    gsl_vector_memcpy(parameters.get_gsl_vector(), gsl_multifit_nlinear_position(m_workspace.get()));
+    return FitResult{gsl_multifit_nlinear_niter(m_workspace.get()), gsl_blas_dnrm2(gsl_multifit_nlinear_residual(m_workspace.get())), converged};
+  }
+
+  inline auto NonlinearLeastSquares::covariance(double epsrel) const -> Matrix
+  {
+    if (!m_fitted)
+      throw std::runtime_error{"Covariance before a successful fit"};
+
+    Matrix result(num_parameters(), num_parameters());
+    bits::ErrorHandlerOff errors;
+    bits::check_status(gsl_multifit_nlinear_covar(gsl_multifit_nlinear_jac(m_workspace.get()), epsrel, result.get_gsl_matrix()));
+    return result;
+  }
+
+  namespace bits
+  {
+    template <typename ModelOfRow>
+    inline auto fit_rows(size_t num_residuals, size_t num_parameters, Matrix &parameters, const LeastSquaresSettings &settings,
+                         ModelOfRow model_of_row) -> std::vector<FitResult>
+    {
+      if (parameters.num_collumns() != num_parameters)
+        throw std::range_error{"Diffrent number of model parameters and collumns"};
+
+      std::vector<FitResult> results(parameters.num_rows());
+      solve_rows(
+          parameters.get_gsl_matrix(), num_parameters, [&]
+          { return NonlinearLeastSquares(num_residuals, num_parameters, settings); },
+          [&](NonlinearLeastSquares &solver, size_t i, Vector &row)
+          { results[i] = solver.fit(model_of_row(i), row); });
+      return results;
+    }
+  }
+
+  inline auto fit_batch(const LeastSquaresModel &model, Matrix &parameters, LeastSquaresSettings settings) -> std::vector<FitResult>
+  {
+    return bits::fit_rows(model.num_residuals(), model.num_parameters(), parameters, settings, [&](size_t) -> const LeastSquaresModel &
+                          { return model; });
+  }
+
+  inline auto fit_batch(const std::vector<LeastSquaresModel> &models, Matrix &parameters, LeastSquaresSettings settings) -> std::vector<FitResult>
+  {
+    if (models.empty() || models.size() != parameters.num_rows())
+      throw std::range_error{"Diffrent number of least squares models and parameter rows"};
+    for (const LeastSquaresModel &model : models)
+    {
+      if (model.num_residuals() != models.front().num_residuals() || model.num_parameters() != models.front().num_parameters())
+        throw std::range_error{"Batched least squares models of diffrent shapes"};
+    }
+
+    return bits::fit_rows(models.front().num_residuals(), models.front().num_parameters(), parameters, settings, [&](size_t i) -> const LeastSquaresModel &
+                          { return models[i]; });
+  }
+}
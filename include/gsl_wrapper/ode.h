@@ -0,0 +1,334 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_odeiv2.h>
+
+#include "bits/callbacks.h"
+#include "bits/error-handler.h"
+#include "matrix.h"
+#include "vector.h"
+
+namespace gsl_wrapper
+{
+  // Right hand side dy/dt = f(t, y) and its Jacobian df/dy with df/dt
+  //
+  // y, dydt, dfdy and dfdt are views of the stepper's own arrays and are
+  // only valid during the call. Implicit steppers call the Jacobian, the
+  // others only the right hand side. integrate_batch runs one system on
+  // several threads at once.
+  class OdeSystem
+  {
+  public:
+    using Function = std::function<void(double t, const Vector &y, Vector &dydt)>;
+    using Jacobian = std::function<void(double t, const Vector &y, Matrix &dfdy, Vector &dfdt)>;
+
+    // Constructors
+    OdeSystem(size_t dimension, Function function, Jacobian jacobian = nullptr);
+
+    // Member functions
+    auto dimension() const -> size_t;
+    auto has_jacobian() const -> bool;
+    auto function(double t, const Vector &y, Vector &dydt) const -> void;
+    auto jacobian(double t, const Vector &y, Matrix &dfdy, Vector &dfdt) const -> void;
+
+  private:
+    size_t m_dimension;
+    Function m_function;
+    Jacobian m_jacobian;
+  };
+
+  enum class OdeStepper
+  {
+    // Explicit, gsl_odeiv2_step_rk2, rk4, rkf45, rkck and rk8pd
+    RungeKutta2,
+    RungeKutta4,
+    RungeKuttaFehlberg45,
+    RungeKuttaCashKarp,
+    RungeKuttaPrinceDormand,
+    // Implicit, gsl_odeiv2_step_rk1imp, rk2imp, rk4imp and bsimp
+    ImplicitEuler,
+    ImplicitRungeKutta2,
+    ImplicitRungeKutta4,
+    BulirschStoer,
+    // Multistep, gsl_odeiv2_step_msadams and msbdf
+    AdamsMoulton,
+    BackwardDifferentiation
+  };
+
+  struct OdeSettings
+  {
+    OdeStepper stepper = OdeStepper::RungeKuttaFehlberg45;
+    double initial_step = 1e-6;
+    double absolute_tolerance = 1e-8;
+    double relative_tolerance = 1e-8;
+    // Zero leaves the default of gsl_odeiv2_driver
+    double min_step = 0.0;
+    double max_step = 0.0;
+    size_t max_steps = 0;
+  };
+
+  namespace bits
+  {
+    using OdeCallbacks = CallbackState<OdeSystem>;
+
+    inline auto ode_function(double t, const double y[], double dydt[], void *params) -> int
+    {
+      return static_cast<OdeCallbacks *>(params)->call([&](const OdeSystem &system)
+                                                       {
+                                                         // GSL never writes y, the view only has no const flavour
+                                                         const Vector y_view = Vector::view(const_cast<double *>(y), system.dimension());
+                                                         Vector dydt_view = Vector::view(dydt, system.dimension());
+                                                         system.function(t, y_view, dydt_view); });
+    }
+
+    inline auto ode_jacobian(double t, const double y[], double *dfdy, double dfdt[], void *params) -> int
+    {
+      return static_cast<OdeCallbacks *>(params)->call([&](const OdeSystem &system)
+                                                       {
+                                                         const Vector y_view = Vector::view(const_cast<double *>(y), system.dimension());
+                                                         Matrix dfdy_view = Matrix::view(dfdy, system.dimension(), system.dimension());
+                                                         Vector dfdt_view = Vector::view(dfdt, system.dimension());
+                                                         system.jacobian(t, y_view, dfdy_view, dfdt_view); });
+    }
+
+    inline auto ode_step_type(OdeStepper stepper) -> const gsl_odeiv2_step_type *
+    {
+      switch (stepper)
+      {
+      case OdeStepper::RungeKutta2:
+        return gsl_odeiv2_step_rk2;
+      case OdeStepper::RungeKutta4:
+        return gsl_odeiv2_step_rk4;
+      case OdeStepper::RungeKuttaFehlberg45:
+        return gsl_odeiv2_step_rkf45;
+      case OdeStepper::RungeKuttaCashKarp:
+        return gsl_odeiv2_step_rkck;
+      case OdeStepper::RungeKuttaPrinceDormand:
+        return gsl_odeiv2_step_rk8pd;
+      case OdeStepper::ImplicitEuler:
+        return gsl_odeiv2_step_rk1imp;
+      case OdeStepper::ImplicitRungeKutta2:
+        return gsl_odeiv2_step_rk2imp;
+      case OdeStepper::ImplicitRungeKutta4:
+        return gsl_odeiv2_step_rk4imp;
+      case OdeStepper::BulirschStoer:
+        return gsl_odeiv2_step_bsimp;
+      case OdeStepper::AdamsMoulton:
+        return gsl_odeiv2_step_msadams;
+      case OdeStepper::BackwardDifferentiation:
+        return gsl_odeiv2_step_msbdf;
+      }
+      throw std::runtime_error{"Unknown ODE stepper"};
+    }
+
+    inline auto ode_needs_jacobian(OdeStepper stepper) -> bool
+    {
+      return stepper == OdeStepper::ImplicitEuler || stepper == OdeStepper::ImplicitRungeKutta2 ||
+             stepper == OdeStepper::ImplicitRungeKutta4 || stepper == OdeStepper::BulirschStoer ||
+             stepper == OdeStepper::BackwardDifferentiation;
+    }
+
+    struct OdeDriverFree
+    {
+      auto operator()(gsl_odeiv2_driver *driver) const -> void
+      {
+        gsl_odeiv2_driver_free(driver);
+      }
+    };
+  }
+
+  // Integrator of systems of one dimension on top of gsl_odeiv2_driver
+  //
+  // The stepper, step size control and evolution objects are allocated once
+  // and reset between integrations, any number of systems of the dimension
+  // can be integrated one after the other with the same driver.
+  class OdeDriver
+  {
+  public:
+    // Constructors
+    OdeDriver(size_t dimension, OdeSettings settings = {});
+
+    // Member functions
+    auto dimension() const -> size_t;
+    auto settings() const -> const OdeSettings &;
+
+    // Advances y from t to t1, t ends at t1
+    auto integrate(const OdeSystem &system, double &t, double t1, Vector &y) -> void;
+
+    // Row i of the result is the state at times[i], y ends at the last time
+    auto trajectory(const OdeSystem &system, double t0, const Vector &times, Vector &y) -> Matrix;
+
+  private:
+    auto apply(const OdeSystem &system, double &t, double t1, double *y) -> void;
+
+    OdeSettings m_settings;
+    // gsl_odeiv2_driver_alloc_y_new stores &*m_system, whose params point
+    // at *m_callbacks, so neither may move with the driver
+    std::unique_ptr<bits::OdeCallbacks> m_callbacks;
+    std::unique_ptr<gsl_odeiv2_system> m_system;
+    std::unique_ptr<gsl_odeiv2_driver, bits::OdeDriverFree> m_driver;
+  };
+
+  // Integrates every row of states from t0 to t1 in place, with one system
+  // for all rows or systems[i] for row i, splitting the rows between the
+  // threads of the shared pool. Each thread reuses one driver for its rows.
+  auto integrate_batch(const OdeSystem &system, double t0, double t1, Matrix &states, OdeSettings settings = {}) -> void;
+  auto integrate_batch(const std::vector<OdeSystem> &systems, double t0, double t1, Matrix &states, OdeSettings settings = {}) -> void;
+
+  inline OdeSystem::OdeSystem(size_t dimension, Function function, Jacobian jacobian)
+      : m_dimension{dimension}, m_function{std::move(function)}, m_jacobian{std::move(jacobian)}
+  {
+    if (m_dimension == 0)
+      throw std::range_error{"ODE system of dimension zero"};
+    if (!m_function)
+      throw std::runtime_error{"ODE system without a right hand side"};
+  }
+
+  inline auto OdeSystem::dimension() const -> size_t
+  {
+    return m_dimension;
+  }
+
+  inline auto OdeSystem::has_jacobian() const -> bool
+  {
+    return static_cast<bool>(m_jacobian);
+  }
+
+  inline auto OdeSystem::function(double t, const Vector &y, Vector &dydt) const -> void
+  {
+    m_function(t, y, dydt);
+  }
+
+  inline auto OdeSystem::jacobian(double t, const Vector &y, Matrix &dfdy, Vector &dfdt) const -> void
+  {
+    if (!m_jacobian)
+      throw std::runtime_error{"ODE system without a Jacobian"};
+    m_jacobian(t, y, dfdy, dfdt);
+  }
+
+  inline OdeDriver::OdeDriver(size_t dimension, OdeSettings settings)
+      : m_settings{settings},
+        m_callbacks{std::make_unique<bits::OdeCallbacks>()},
+        m_system{std::make_unique<gsl_odeiv2_system>()}
+  {
+    if (dimension == 0)
+      throw std::range_error{"ODE system of dimension zero"};
+
+    *m_system = gsl_odeiv2_system{bits::ode_function, bits::ode_jacobian, dimension, m_callbacks.get()};
+    m_driver.reset(gsl_odeiv2_driver_alloc_y_new(m_system.get(), bits::ode_step_type(settings.stepper), settings.initial_step,
+                                                 settings.absolute_tolerance, settings.relative_tolerance));
+    if (!m_driver)
+      throw std::runtime_error{"Failed to allocate the ODE driver"};
+
+    if (settings.min_step > 0.0)
+      gsl_odeiv2_driver_set_hmin(m_driver.get(), settings.min_step);
+    if (settings.max_step > 0.0)
+      gsl_odeiv2_driver_set_hmax(m_driver.get(), settings.max_step);
+    if (settings.max_steps > 0)
+      gsl_odeiv2_driver_set_nmax(m_driver.get(), settings.max_steps);
+  }
+
+  inline auto OdeDriver::dimension() const -> size_t
+  {
+    return m_system->dimension;
+  }
+
+  inline auto OdeDriver::settings() const -> const OdeSettings &
+  {
+    return m_settings;
+  }
+
+  inline auto OdeDriver::apply(const OdeSystem &system, double &t, double t1, double *y) -> void
+  {
+    m_callbacks->start(system);
+
+    // Every integration starts over from the initial step size
+    bits::ErrorHandlerOff errors;
+    gsl_odeiv2_driver_reset_hstart(m_driver.get(), t1 >= t ? m_settings.initial_step : -m_settings.initial_step);
+    const int status = gsl_odeiv2_driver_apply(m_driver.get(), &t, t1, y);
+
+    m_callbacks->finish();
+    bits::check_status(status);
+  }
+
+  inline auto OdeDriver::integrate(const OdeSystem &system, double &t, double t1, Vector &y) -> void
+  {
+    if (system.dimension() != dimension() || y.size() != dimension())
+      throw std::range_error{"Diffrent dimensions of ODE system, driver and state"};
+    if (bits::ode_needs_jacobian(m_settings.stepper) && !system.has_jacobian())
+      throw std::runtime_error{"ODE stepper needs the Jacobian of the system"};
+
+    gsl_vector *state = y.get_gsl_vector();
+    if (state->stride == 1)
+    {
+      apply(system, t, t1, state->data);
+      return;
+    }
+
+    // The driver wants contiguous elements
+    Vector contiguous(y);
+    apply(system, t, t1, contiguous.get_gsl_vector()->data);
+    gsl_vector_memcpy(state, contiguous.get_gsl_vector());
+  }
+
+  inline auto OdeDriver::trajectory(const OdeSystem &system, double t0, const Vector &times, Vector &y) -> Matrix
+  {
+    if (times.size() == 0)
+      throw std::range_error{"Trajectory without output times"};
+
+    Matrix result(times.size(), dimension());
+    double t = t0;
+    for (size_t i = 0; i < times.size(); i++)
+    {
+      integrate(system, t, times[i], y);
+      gsl_vector_view row = gsl_matrix_row(result.get_gsl_matrix(), i);
+      gsl_vector_memcpy(&row.vector, y.get_gsl_vector());
+    }
+    return result;
+  }
+
+  namespace bits
+  {
+    template <typename SystemOfRow>
+    inline auto integrate_rows(size_t dimension, double t0, double t1, Matrix &states, const OdeSettings &settings, SystemOfRow system_of_row) -> void
+    {
+      if (states.num_collumns() != dimension)
+        throw std::range_error{"Diffrent dimensions of ODE system and states"};
+
+      solve_rows(
+          states.get_gsl_matrix(), dimension, [&]
+          { return OdeDriver(dimension, settings); },
+          [&](OdeDriver &driver, size_t i, Vector &state)
+          {
+            double t = t0;
+            driver.integrate(system_of_row(i), t, t1, state);
+          });
+    }
+  }
+
+  inline auto integrate_batch(const OdeSystem &system, double t0, double t1, Matrix &states, OdeSettings settings) -> void
+  {
+    bits::integrate_rows(system.dimension(), t0, t1, states, settings, [&](size_t) -> const OdeSystem &
+                         { return system; });
+  }
+
+  inline auto integrate_batch(const std::vector<OdeSystem> &systems, double t0, double t1, Matrix &states, OdeSettings settings) -> void
+  {
+    if (systems.empty() || systems.size() != states.num_rows())
+      throw std::range_error{"Diffrent number of ODE systems and states"};
+    for (const OdeSystem &system : systems)
+    {
+      if (system.dimension() != systems.front().dimension())
+        throw std::range_error{"Batched ODE systems of diffrent dimensions"};
+    }
+
+    bits::integrate_rows(systems.front().dimension(), t0, t1, states, settings, [&](size_t i) -> const OdeSystem &
+                         { return systems[i]; });
+  }
+}
@@ -0,0 +1,433 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_interp.h>
+
+#include "bits/error-handler.h"
+#include "bits/thread-pool.h"
+#include "bits/workspace-cache.h"
+#include "matrix.h"
+#include "vector.h"
+
+namespace gsl_wrapper
+{
+  enum class SplineType
+  {
+    Linear,
+    Polynomial,
+    Cubic,
+    CubicPeriodic,
+    Akima,
+    AkimaPeriodic,
+    Steffen
+  };
+
+  namespace bits
+  {
+    struct InterpFree
+    {
+      auto operator()(gsl_interp *interp) const -> void
+      {
+        gsl_interp_free(interp);
+      }
+    };
+
+    using InterpPointer = std::unique_ptr<gsl_interp, InterpFree>;
+
+    // gsl_interp_eval_e and its derivative flavours
+    using SplineEval = int (*)(const gsl_interp *, const double[], const double[], double, gsl_interp_accel *, double *);
+  }
+
+  // Interpolation of the points (x[i], y[i]) with strictly increasing x
+  //
+  // Batched evaluation finds the grid interval of a run of non-decreasing
+  // queries by merging them with the grid, unsorted ones by binary search,
+  // and splits large batches between the threads of the shared pool.
+  // Accelerators are cached per thread, so a Spline can be evaluated from
+  // several threads at once.
+  class Spline
+  {
+  public:
+    // Constructors
+    Spline(const Vector &x, const Vector &y, SplineType type = SplineType::Cubic);
+
+    // Member functions
+    auto size() const -> size_t;
+    auto x() const -> const Vector &;
+    auto y() const -> const Vector &;
+
+    auto derivative(double x) const -> double;
+    auto second_derivative(double x) const -> double;
+    auto integral(double a, double b) const -> double;
+
+    auto evaluate(const Vector &x) const -> Vector;
+    auto evaluate(const Vector &x, Vector &result) const -> void;
+    auto derivative(const Vector &x) const -> Vector;
+    auto second_derivative(const Vector &x) const -> Vector;
+
+    // Operators
+    auto operator()(double x) const -> double;
+
+  private:
+    auto point(double x, bits::SplineEval eval) const -> double;
+    auto batch(const Vector &x, Vector &result, bits::SplineEval eval) const -> void;
+
+    Vector m_x;
+    Vector m_y;
+    bits::InterpPointer m_interp;
+  };
+
+  // Many curves sampled on one grid, row i of y being curve i
+  //
+  // The grid is stored once and the interval of every query is found once
+  // for all of the curves.
+  class SplineCurves
+  {
+  public:
+    // Constructors
+    SplineCurves(const Vector &x, const Matrix &y, SplineType type = SplineType::Cubic);
+
+    // Member functions
+    auto size() const -> size_t;
+    auto num_curves() const -> size_t;
+    auto x() const -> const Vector &;
+
+    // Element (i, j) of the result is curve i at x[j]
+    auto evaluate(const Vector &x) const -> Matrix;
+    auto evaluate(const Vector &x, Matrix &result) const -> void;
+
+    // Operators
+    auto operator()(size_t curve, double x) const -> double;
+
+  private:
+    Vector m_x;
+    Matrix m_y;
+    std::vector<bits::InterpPointer> m_interps;
+  };
+
+  namespace bits
+  {
+    // Batches with fewer evaluations than this stay on the calling thread
+    constexpr size_t spline_parallel_threshold = size_t{1} << 14;
+
+    // Queries located together before they are evaluated
+    constexpr size_t spline_block = 256;
+
+    inline auto interp_accel_alloc(size_t) -> gsl_interp_accel *
+    {
+      return gsl_interp_accel_alloc();
+    }
+
+    // Every thread keeps its accelerators, all under the key zero
+    using InterpAccelerators = WorkspaceCache<gsl_interp_accel, interp_accel_alloc, gsl_interp_accel_free>;
+
+    // The accelerator of the thread for a grid of grid_size points. It is
+    // shared by every spline, and gsl_interp_accel_find reads the grid at the
+    // cached interval before searching, so an interval left by a larger grid
+    // is dropped. Intervals inside the grid are only a hint and stay.
+    inline auto grid_accelerator(size_t grid_size) -> InterpAccelerators::Lease
+    {
+      auto accel = InterpAccelerators::acquire(0);
+      if (accel->cache + 1 >= grid_size)
+        gsl_interp_accel_reset(accel.get());
+      return accel;
+    }
+
+    inline auto spline_interp_type(SplineType type) -> const gsl_interp_type *
+    {
+      switch (type)
+      {
+      case SplineType::Linear:
+        return gsl_interp_linear;
+      case SplineType::Polynomial:
+        return gsl_interp_polynomial;
+      case SplineType::Cubic:
+        return gsl_interp_cspline;
+      case SplineType::CubicPeriodic:
+        return gsl_interp_cspline_periodic;
+      case SplineType::Akima:
+        return gsl_interp_akima;
+      case SplineType::AkimaPeriodic:
+        return gsl_interp_akima_periodic;
+      case SplineType::Steffen:
+        return gsl_interp_steffen;
+      }
+      throw std::runtime_error{"Unknown spline type"};
+    }
+
+    // Callers keep an ErrorHandlerOff alive, otherwise GSL aborts first
+    inline auto check_spline_status(int status) -> void
+    {
+      if (status == GSL_EDOM)
+        throw std::range_error{"Interpolating outside of the spline range"};
+      check_status(status);
+    }
+
+    // gsl_interp_init reports unsorted grids as a generic invalid argument,
+    // so the grid is checked here first for a clearer error
+    inline auto make_interp(SplineType type, const double *grid, const double *values, size_t size) -> InterpPointer
+    {
+      const gsl_interp_type *interp_type = spline_interp_type(type);
+      if (size < gsl_interp_type_min_size(interp_type))
+        throw std::range_error{"Too few points for the spline type"};
+      for (size_t i = 1; i < size; i++)
+      {
+        if (!(grid[i - 1] < grid[i]))
+          throw std::runtime_error{"Spline x values must be strictly increasing"};
+      }
+
+      ErrorHandlerOff errors;
+      InterpPointer interp{gsl_interp_alloc(interp_type, size)};
+      if (!interp)
+        throw std::bad_alloc{};
+      check_spline_status(gsl_interp_init(interp.get(), grid, values, size));
+      return interp;
+    }
+
+    // Grid intervals of `count` queries, merging non-decreasing runs with
+    // the grid and searching for the others
+    inline auto spline_intervals(const double *grid, size_t size, const double *queries, size_t stride, size_t count, size_t *intervals) -> void
+    {
+      bool sorted = true;
+      for (size_t i = 0; i < count; i++)
+      {
+        const double x = queries[i * stride];
+        // Written to also catch NaN
+        if (!(x >= grid[0] && x <= grid[size - 1]))
+          throw std::range_error{"Interpolating outside of the spline range"};
+        if (i > 0 && x < queries[(i - 1) * stride])
+          sorted = false;
+      }
+
+      if (!sorted)
+      {
+        for (size_t i = 0; i < count; i++)
+          intervals[i] = gsl_interp_bsearch(grid, queries[i * stride], 0, size - 1);
+        return;
+      }
+
+      size_t index = count > 0 ? gsl_interp_bsearch(grid, queries[0], 0, size - 1) : 0;
+      for (size_t i = 0; i < count; i++)
+      {
+        const double x = queries[i * stride];
+        while (index + 2 < size && x >= grid[index + 1])
+          index++;
+        intervals[i] = index;
+      }
+    }
+
+    // Evaluates at located queries, the accelerator is pointed at the known
+    // interval so GSL does not search again
+    inline auto spline_evaluate(const gsl_interp *interp, const double *grid, const double *values, const double *queries, size_t stride,
+                                const size_t *intervals, size_t count, double *out, size_t out_stride, gsl_interp_accel *accel, SplineEval eval) -> void
+    {
+      ErrorHandlerOff errors;
+      for (size_t i = 0; i < count; i++)
+      {
+        accel->cache = intervals[i];
+        check_spline_status(eval(interp, grid, values, queries[i * stride], accel, out + i * out_stride));
+      }
+    }
+
+    // Runs body(begin, end) over the queries, in parallel when there are
+    // enough evaluations in total
+    template <typename Body>
+    inline auto for_spline_queries(size_t count, size_t evaluations, Body body) -> void
+    {
+      if (evaluations < spline_parallel_threshold)
+      {
+        body(0, count);
+        return;
+      }
+      ThreadPool::shared().parallel_for(count, body);
+    }
+  }
+
+  inline Spline::Spline(const Vector &x, const Vector &y, SplineType type)
+      : m_x{x}, m_y{y}
+  {
+    if (m_x.size() != m_y.size())
+      throw std::range_error{"Diffrent number of x and y values of a spline"};
+
+    // The copies are contiguous
+    m_interp = bits::make_interp(type, m_x.get_gsl_vector()->data, m_y.get_gsl_vector()->data, m_x.size());
+  }
+
+  inline auto Spline::size() const -> size_t
+  {
+    return m_x.size();
+  }
+
+  inline auto Spline::x() const -> const Vector &
+  {
+    return m_x;
+  }
+
+  inline auto Spline::y() const -> const Vector &
+  {
+    return m_y;
+  }
+
+  inline auto Spline::point(double x, bits::SplineEval eval) const -> double
+  {
+    // The accelerator of the thread remembers the last interval
+    bits::ErrorHandlerOff errors;
+    auto accel = bits::grid_accelerator(size());
+    double result;
+    bits::check_spline_status(eval(m_interp.get(), m_x.get_gsl_vector()->data, m_y.get_gsl_vector()->data, x, accel.get(), &result));
+    return result;
+  }
+
+  inline auto Spline::operator()(double x) const -> double
+  {
+    return point(x, gsl_interp_eval_e);
+  }
+
+  inline auto Spline::derivative(double x) const -> double
+  {
+    return point(x, gsl_interp_eval_deriv_e);
+  }
+
+  inline auto Spline::second_derivative(double x) const -> double
+  {
+    return point(x, gsl_interp_eval_deriv2_e);
+  }
+
+  inline auto Spline::integral(double a, double b) const -> double
+  {
+    bits::ErrorHandlerOff errors;
+    auto accel = bits::grid_accelerator(size());
+    double result;
+    bits::check_spline_status(gsl_interp_eval_integ_e(m_interp.get(), m_x.get_gsl_vector()->data, m_y.get_gsl_vector()->data, a, b, accel.get(), &result));
+    return result;
+  }
+
+  inline auto Spline::batch(const Vector &x, Vector &result, bits::SplineEval eval) const -> void
+  {
+    if (x.size() != result.size())
+      throw std::range_error{"Diffrent sizes of query and result vectors"};
+
+    const gsl_vector *queries = x.get_gsl_vector();
+    gsl_vector *out = result.get_gsl_vector();
+    const double *grid = m_x.get_gsl_vector()->data;
+    const double *values = m_y.get_gsl_vector()->data;
+
+    bits::for_spline_queries(x.size(), x.size(), [&](size_t begin, size_t end)
+                             {
+                               auto accel = bits::InterpAccelerators::acquire(0);
+                               size_t intervals[bits::spline_block];
+                               for (size_t start = begin; start < end; start += bits::spline_block)
+                               {
+                                 const size_t count = std::min(bits::spline_block, end - start);
+                                 const double *block = queries->data + start * queries->stride;
+                                 bits::spline_intervals(grid, size(), block, queries->stride, count, intervals);
+                                 bits::spline_evaluate(m_interp.get(), grid, values, block, queries->stride, intervals, count,
+                                                       out->data + start * out->stride, out->stride, accel.get(), eval);
+                               } });
+  }
+
+  inline auto Spline::evaluate(const Vector &x) const -> Vector
+  {
+    Vector result(x.size());
+    batch(x, result, gsl_interp_eval_e);
+    return result;
+  }
+
+  inline auto Spline::evaluate(const Vector &x, Vector &result) const -> void
+  {
+    batch(x, result, gsl_interp_eval_e);
+  }
+
+  inline auto Spline::derivative(const Vector &x) const -> Vector
+  {
+    Vector result(x.size());
+    batch(x, result, gsl_interp_eval_deriv_e);
+    return result;
+  }
+
+  inline auto Spline::second_derivative(const Vector &x) const -> Vector
+  {
+    Vector result(x.size());
+    batch(x, result, gsl_interp_eval_deriv2_e);
+    return result;
+  }
+
+  inline SplineCurves::SplineCurves(const Vector &x, const Matrix &y, SplineType type)
+      : m_x{x}, m_y{y}
+  {
+    if (m_y.num_collumns() != m_x.size())
+      throw std::range_error{"Diffrent number of x values and curve samples"};
+
+    const gsl_matrix *curves = m_y.get_gsl_matrix();
+    m_interps.reserve(curves->size1);
+    for (size_t i = 0; i < curves->size1; i++)
+      m_interps.push_back(bits::make_interp(type, m_x.get_gsl_vector()->data, curves->data + i * curves->tda, m_x.size()));
+  }
+
+  inline auto SplineCurves::size() const -> size_t
+  {
+    return m_x.size();
+  }
+
+  inline auto SplineCurves::num_curves() const -> size_t
+  {
+    return m_interps.size();
+  }
+
+  inline auto SplineCurves::x() const -> const Vector &
+  {
+    return m_x;
+  }
+
+  inline auto SplineCurves::operator()(size_t curve, double x) const -> double
+  {
+    if (curve >= m_interps.size())
+      throw std::range_error{"Accesing curve out of range"};
+
+    const gsl_matrix *curves = m_y.get_gsl_matrix();
+    bits::ErrorHandlerOff errors;
+    auto accel = bits::grid_accelerator(size());
+    double result;
+    bits::check_spline_status(gsl_interp_eval_e(m_interps[curve].get(), m_x.get_gsl_vector()->data, curves->data + curve * curves->tda, x, accel.get(), &result));
+    return result;
+  }
+
+  inline auto SplineCurves::evaluate(const Vector &x) const -> Matrix
+  {
+    Matrix result(num_curves(), x.size());
+    evaluate(x, result);
+    return result;
+  }
+
+  inline auto SplineCurves::evaluate(const Vector &x, Matrix &result) const -> void
+  {
+    if (result.num_rows() != num_curves() || result.num_collumns() != x.size())
+      throw std::range_error{"Diffrent sizes of queries, curves and result matrix"};
+
+    const gsl_vector *queries = x.get_gsl_vector();
+    const gsl_matrix *curves = m_y.get_gsl_matrix();
+    gsl_matrix *out = result.get_gsl_matrix();
+    const double *grid = m_x.get_gsl_vector()->data;
+
+    bits::for_spline_queries(x.size(), x.size() * num_curves(), [&](size_t begin, size_t end)
+                             {
+                               auto accel = bits::InterpAccelerators::acquire(0);
+                               size_t intervals[bits::spline_block];
+                               for (size_t start = begin; start < end; start += bits::spline_block)
+                               {
+                                 const size_t count = std::min(bits::spline_block, end - start);
+                                 const double *block = queries->data + start * queries->stride;
+                                 bits::spline_intervals(grid, size(), block, queries->stride, count, intervals);
+                                 for (size_t curve = 0; curve < m_interps.size(); curve++)
+                                 {
+                                   bits::spline_evaluate(m_interps[curve].get(), grid, curves->data + curve * curves->tda, block, queries->stride,
+                                                         intervals, count, out->data + curve * out->tda + start, 1, accel.get(), gsl_interp_eval_e);
+                                 }
+                               } });
+  }
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <stdexcept>
+#include <utility>
+
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_linalg.h>
+
+#include "bits/error-handler.h"
+#include "bits/workspace-cache.h"
+#include "matrix.h"
+#include "vector.h"
+
+namespace gsl_wrapper
+{
+  // Singular value decomposition A = U S V^T
+  //
+  // For an m x n matrix with k = min(m, n), U is m x k, V is n x k and the k
+  // singular values come in decreasing order. An rvalue input is consumed:
+  // a tall one is decomposed in its own storage, which becomes U, and the
+  // argument is left empty like any moved from matrix.
+  class SVD
+  {
+  public:
+    enum class Method
+    {
+      // gsl_linalg_SV_decomp
+      GolubReinsch,
+      // Golub-Reinsch after a QR step, faster when m is much larger than n
+      Modified,
+      // One-sided Jacobi orthogonalization of the collumns, which works on
+      // contiguous collumn pairs of tall matrices and gives more accurate
+      // small singular values
+      Jacobi
+    };
+
+    // Constructors
+    SVD(const Matrix &matrix, Method method = Method::GolubReinsch);
+    SVD(Matrix &&matrix, Method method = Method::GolubReinsch);
+
+    // Member functions
+    auto u() const -> const Matrix &;
+    auto singular_values() const -> const Vector &;
+    auto v() const -> const Matrix &;
+    auto rank(double tolerance) const -> size_t;
+
+  private:
+    auto decompose(Method method) -> void;
+
+    bool m_transposed;
+    Matrix m_u;
+    Vector m_singular_values;
+    Matrix m_v;
+  };
+
+  namespace bits
+  {
+    inline auto square_matrix_alloc(size_t size) -> gsl_matrix *
+    {
+      return gsl_matrix_alloc(size, size);
+    }
+
+    using SVDWorkVectors = WorkspaceCache<gsl_vector, gsl_vector_alloc, gsl_vector_free>;
+    using SVDWorkMatrices = WorkspaceCache<gsl_matrix, square_matrix_alloc, gsl_matrix_free>;
+
+    // The GSL routines need m >= n, so wide matrices are decomposed transposed
+    inline auto tall_matrix(Matrix &&matrix) -> Matrix
+    {
+      if (matrix.num_rows() == 0 || matrix.num_collumns() == 0)
+        throw std::range_error{"Singular value decomposition of an empty matrix"};
+      if (matrix.num_rows() >= matrix.num_collumns())
+        return std::move(matrix);
+
+      Matrix result(matrix.num_collumns(), matrix.num_rows());
+      gsl_matrix_transpose_memcpy(result.get_gsl_matrix(), matrix.get_gsl_matrix());
+      return result;
+    }
+  }
+
+  inline SVD::SVD(const Matrix &matrix, Method method)
+      : SVD(Matrix(matrix), method)
+  {
+  }
+
+  inline SVD::SVD(Matrix &&matrix, Method method)
+      : m_transposed{matrix.num_rows() < matrix.num_collumns()},
+        m_u{bits::tall_matrix(std::move(matrix))},
+        m_singular_values(m_u.num_collumns()),
+        m_v(m_u.num_collumns())
+  {
+    decompose(method);
+
+    // A^T = U S V^T means A = V S U^T
+    if (m_transposed)
+      std::swap(m_u, m_v);
+  }
+
+  inline auto SVD::decompose(Method method) -> void
+  {
+    const size_t size = m_u.num_collumns();
+    gsl_matrix *a = m_u.get_gsl_matrix();
+    gsl_matrix *v = m_v.get_gsl_matrix();
+    gsl_vector *s = m_singular_values.get_gsl_vector();
+
+    bits::ErrorHandlerOff errors;
+    int status = GSL_SUCCESS;
+    switch (method)
+    {
+    case Method::GolubReinsch:
+    {
+      auto work = bits::SVDWorkVectors::acquire(size);
+      status = gsl_linalg_SV_decomp(a, v, s, work.get());
+      break;
+    }
+    case Method::Modified:
+    {
+      auto x = bits::SVDWorkMatrices::acquire(size);
+      auto work = bits::SVDWorkVectors::acquire(size);
+      status = gsl_linalg_SV_decomp_mod(a, x.get(), v, s, work.get());
+      break;
+    }
+    case Method::Jacobi:
+      status = gsl_linalg_SV_decomp_jacobi(a, v, s);
+      break;
+    }
+
+    bits::check_status(status);
+  }
+
+  inline auto SVD::u() const -> const Matrix &
+  {
+    return m_u;
+  }
+
+  inline auto SVD::singular_values() const -> const Vector &
+  {
+    return m_singular_values;
+  }
+
+  inline auto SVD::v() const -> const Matrix &
+  {
+    return m_v;
+  }
+
+  // Number of singular values above tolerance times the largest one
+  inline auto SVD::rank(double tolerance) const -> size_t
+  {
+    const double threshold = tolerance * m_singular_values[0];
+    size_t result = 0;
+    for (double value : m_singular_values)
+    {
+      if (value > threshold)
+        result++;
+    }
+    return result;
+  }
+}
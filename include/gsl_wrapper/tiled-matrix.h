@@ -0,0 +1,626 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gsl/gsl_blas.h>
+#include <gsl/gsl_matrix.h>
+
+#include "bits/gemm.h"
+#include "bits/thread-pool.h"
+#include "vector.h"
+
+namespace gsl_wrapper
+{
+  // Matrix kept in a file as square tiles of tile_size x tile_size doubles
+  //
+  // Only a bounded number of tiles is held in memory at once, in an LRU cache
+  // that writes modified tiles back when evicting them. Tiles at the right
+  // and bottom edge are stored padded to the full tile size.
+  //
+  // File reads and writes happen without holding the cache lock. Streaming
+  // operations pin the tiles of the current step before prefetching the
+  // next one, so a prefetch never evicts a tile that is being worked on.
+  class TiledMatrix
+  {
+  private:
+    enum class Access
+    {
+      Read,
+      Write,
+      Overwrite
+    };
+
+    struct Entry
+    {
+      size_t key;
+      std::unique_ptr<double[]> data;
+      size_t pins;
+      bool ready;
+      bool dirty;
+    };
+
+  public:
+    // Tile pinned in the cache for as long as the handle lives. Releasing a
+    // write handle marks the tile dirty again, so writes made after a flush()
+    // are not lost.
+    class Tile
+    {
+    public:
+      Tile(const Tile &copy_from) = delete;
+      Tile(Tile &&move_from);
+      ~Tile();
+
+      auto view() const -> gsl_matrix *;
+
+      auto operator=(const Tile &copy_from) -> Tile & = delete;
+      auto operator=(Tile &&move_from) -> Tile & = delete;
+
+    private:
+      friend class TiledMatrix;
+      Tile(const TiledMatrix *owner, Entry *entry, gsl_matrix_view view, bool write);
+
+      const TiledMatrix *m_owner;
+      Entry *m_entry;
+      bool m_write;
+      mutable gsl_matrix_view m_view;
+    };
+
+    // Constructors and destructor
+    TiledMatrix(const std::string &path, size_t num_rows, size_t num_collumns, size_t tile_size, size_t cache_bytes);
+
+    TiledMatrix(const TiledMatrix &copy_from) = delete;
+    TiledMatrix(TiledMatrix &&move_from) = delete;
+
+    ~TiledMatrix();
+
+    // Member functions
+    auto get_dimensions() const -> std::pair<size_t, size_t>;
+    auto num_rows() const -> size_t;
+    auto num_collumns() const -> size_t;
+    auto tile_size() const -> size_t;
+    auto num_tile_rows() const -> size_t;
+    auto num_tile_collumns() const -> size_t;
+
+    auto read_tile(size_t tile_row, size_t tile_collumn) const -> Tile;
+    auto write_tile(size_t tile_row, size_t tile_collumn) -> Tile;
+    auto prefetch(size_t tile_row, size_t tile_collumn) const -> void;
+    auto flush() -> void;
+
+    auto get(size_t i, size_t j) const -> double;
+    auto set(size_t i, size_t j, double value) -> void;
+
+    // Elementwise operations streaming through the tiles
+    auto apply(const std::function<double(double)> &function) -> void;
+    auto scale(double number) -> void;
+    auto add(const TiledMatrix &matrix) -> void;
+
+    // Operators
+    auto operator=(const TiledMatrix &copy_from) -> TiledMatrix & = delete;
+    auto operator=(TiledMatrix &&move_from) -> TiledMatrix & = delete;
+
+    // Friend declarations
+    friend auto multiply(const TiledMatrix &lhs, const TiledMatrix &rhs, TiledMatrix &result) -> void;
+    friend auto multiply(const TiledMatrix &matrix, const Vector &vec) -> Vector;
+
+  private:
+    auto acquire(size_t tile_row, size_t tile_collumn, Access access) const -> Tile;
+    auto load(size_t key, Access access, bool pin) const -> Entry *;
+    auto release(Entry *entry, bool write) const -> void;
+    auto evict_locked(std::list<Entry> &victims) const -> void;
+    auto restore_locked(std::list<Entry> &victims) const -> void;
+    auto read_from_file(size_t key, double *data) const -> void;
+    auto write_to_file(size_t key, const double *data) const -> void;
+    auto prefetch_after(size_t tile_row, size_t tile_collumn) const -> void;
+    auto for_each_tile(const std::function<void(size_t, size_t)> &body) const -> void;
+
+    int m_file;
+    size_t m_numRows;
+    size_t m_numCollumns;
+    size_t m_tileSize;
+    size_t m_numTileRows;
+    size_t m_numTileCollumns;
+    size_t m_capacity;
+
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_changed;
+    mutable std::list<Entry> m_entries;
+    mutable std::unordered_map<size_t, std::list<Entry>::iterator> m_index;
+    mutable std::unordered_set<size_t> m_writing;
+    mutable size_t m_prefetching;
+  };
+
+  inline TiledMatrix::Tile::Tile(const TiledMatrix *owner, Entry *entry, gsl_matrix_view view, bool write)
+      : m_owner{owner}, m_entry{entry}, m_write{write}, m_view{view}
+  {
+  }
+
+  inline TiledMatrix::Tile::Tile(Tile &&move_from)
+      : m_owner{move_from.m_owner},
+        m_entry{std::exchange(move_from.m_entry, nullptr)},
+        m_write{move_from.m_write},
+        m_view{move_from.m_view}
+  {
+  }
+
+  inline TiledMatrix::Tile::~Tile()
+  {
+    if (m_entry != nullptr)
+      m_owner->release(m_entry, m_write);
+  }
+
+  inline auto TiledMatrix::Tile::view() const -> gsl_matrix *
+  {
+    return &m_view.matrix;
+  }
+
+  inline TiledMatrix::TiledMatrix(const std::string &path, size_t num_rows, size_t num_collumns, size_t tile_size, size_t cache_bytes)
+      : m_file{-1},
+        m_numRows{num_rows},
+        m_numCollumns{num_collumns},
+        m_tileSize{tile_size},
+        m_numTileRows{0},
+        m_numTileCollumns{0},
+        m_capacity{0},
+        m_prefetching{0}
+  {
+    if (tile_size == 0)
+      throw std::range_error{"Tile size has to be positive"};
+
+    m_numTileRows = (num_rows + tile_size - 1) / tile_size;
+    m_numTileCollumns = (num_collumns + tile_size - 1) / tile_size;
+    m_capacity = std::max<size_t>(1, cache_bytes / (tile_size * tile_size * sizeof(double)));
+
+    m_file = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (m_file < 0)
+      throw std::runtime_error{"Cannot open tile file " + path};
+
+    // Growing the file keeps existing tiles, new ones read back as zeros
+    const off_t file_size = static_cast<off_t>(m_numTileRows * m_numTileCollumns * tile_size * tile_size * sizeof(double));
+    struct stat info;
+    if (::fstat(m_file, &info) != 0 || (info.st_size < file_size && ::ftruncate(m_file, file_size) != 0))
+    {
+      ::close(m_file);
+      throw std::runtime_error{"Cannot resize tile file " + path};
+    }
+  }
+
+  inline TiledMatrix::~TiledMatrix()
+  {
+    {
+      std::unique_lock<std::mutex> lock{m_mutex};
+      m_changed.wait(lock, [this]
+                     { return m_prefetching == 0; });
+    }
+
+    try
+    {
+      flush();
+    }
+    catch (...)
+    {
+    }
+    ::close(m_file);
+  }
+
+  inline auto TiledMatrix::get_dimensions() const -> std::pair<size_t, size_t>
+  {
+    return {m_numRows, m_numCollumns};
+  }
+
+  inline auto TiledMatrix::num_rows() const -> size_t
+  {
+    return m_numRows;
+  }
+
+  inline auto TiledMatrix::num_collumns() const -> size_t
+  {
+    return m_numCollumns;
+  }
+
+  inline auto TiledMatrix::tile_size() const -> size_t
+  {
+    return m_tileSize;
+  }
+
+  inline auto TiledMatrix::num_tile_rows() const -> size_t
+  {
+    return m_numTileRows;
+  }
+
+  inline auto TiledMatrix::num_tile_collumns() const -> size_t
+  {
+    return m_numTileCollumns;
+  }
+
+  inline auto TiledMatrix::read_tile(size_t tile_row, size_t tile_collumn) const -> Tile
+  {
+    return acquire(tile_row, tile_collumn, Access::Read);
+  }
+
+  inline auto TiledMatrix::write_tile(size_t tile_row, size_t tile_collumn) -> Tile
+  {
+    return acquire(tile_row, tile_collumn, Access::Write);
+  }
+
+  inline auto TiledMatrix::prefetch(size_t tile_row, size_t tile_collumn) const -> void
+  {
+    if (tile_row >= m_numTileRows || tile_collumn >= m_numTileCollumns)
+      return;
+
+    const size_t key = tile_row * m_numTileCollumns + tile_collumn;
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      if (m_index.count(key) != 0)
+        return;
+      ++m_prefetching;
+    }
+
+    bits::ThreadPool::shared().submit([this, key]
+                                      {
+                                        try
+                                        {
+                                          load(key, Access::Read, false);
+                                        }
+                                        catch (...)
+                                        {
+                                          // A failed prefetch is retried by the next real access
+                                        }
+
+                                        std::lock_guard<std::mutex> lock{m_mutex};
+                                        --m_prefetching;
+                                        m_changed.notify_all(); });
+  }
+
+  inline auto TiledMatrix::flush() -> void
+  {
+    // Dirty tiles are pinned while they are written outside the lock, and
+    // tiles still on their way out of the cache are waited for
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_changed.wait(lock, [this]
+                   { return m_writing.empty(); });
+
+    std::vector<Entry *> dirty;
+    for (auto &&entry : m_entries)
+    {
+      if (entry.ready && entry.dirty)
+      {
+        ++entry.pins;
+        entry.dirty = false;
+        dirty.push_back(&entry);
+      }
+    }
+    lock.unlock();
+
+    size_t written = 0;
+    try
+    {
+      for (; written < dirty.size(); written++)
+        write_to_file(dirty[written]->key, dirty[written]->data.get());
+    }
+    catch (...)
+    {
+      lock.lock();
+      for (size_t i = 0; i < dirty.size(); i++)
+      {
+        dirty[i]->dirty = dirty[i]->dirty || i >= written;
+        --dirty[i]->pins;
+      }
+      throw;
+    }
+
+    lock.lock();
+    for (Entry *entry : dirty)
+      --entry->pins;
+  }
+
+  inline auto TiledMatrix::get(size_t i, size_t j) const -> double
+  {
+    if (i >= m_numRows || j >= m_numCollumns)
+      throw std::range_error{"Accesing matrix elements out of bounds"};
+
+    Tile tile = read_tile(i / m_tileSize, j / m_tileSize);
+    return gsl_matrix_get(tile.view(), i % m_tileSize, j % m_tileSize);
+  }
+
+  inline auto TiledMatrix::set(size_t i, size_t j, double value) -> void
+  {
+    if (i >= m_numRows || j >= m_numCollumns)
+      throw std::range_error{"Accesing matrix elements out of bounds"};
+
+    Tile tile = write_tile(i / m_tileSize, j / m_tileSize);
+    gsl_matrix_set(tile.view(), i % m_tileSize, j % m_tileSize, value);
+  }
+
+  inline auto TiledMatrix::apply(const std::function<double(double)> &function) -> void
+  {
+    for_each_tile([this, &function](size_t tile_row, size_t tile_collumn)
+                  {
+                    Tile tile = write_tile(tile_row, tile_collumn);
+                    prefetch_after(tile_row, tile_collumn);
+
+                    gsl_matrix *view = tile.view();
+                    for (size_t i = 0; i < view->size1; i++)
+                    {
+                      double *row = gsl_matrix_ptr(view, i, 0);
+                      for (size_t j = 0; j < view->size2; j++)
+                      {
+                        row[j] = function(row[j]);
+                      }
+                    } });
+  }
+
+  inline auto TiledMatrix::scale(double number) -> void
+  {
+    for_each_tile([this, number](size_t tile_row, size_t tile_collumn)
+                  {
+                    Tile tile = write_tile(tile_row, tile_collumn);
+                    prefetch_after(tile_row, tile_collumn);
+                    gsl_matrix_scale(tile.view(), number); });
+  }
+
+  inline auto TiledMatrix::add(const TiledMatrix &matrix) -> void
+  {
+    if ((m_numRows != matrix.m_numRows) || (m_numCollumns != matrix.m_numCollumns) || (m_tileSize != matrix.m_tileSize))
+      throw std::range_error{"Wrong matrix sizes when adding"};
+
+    for_each_tile([this, &matrix](size_t tile_row, size_t tile_collumn)
+                  {
+                    Tile other = matrix.read_tile(tile_row, tile_collumn);
+                    Tile tile = write_tile(tile_row, tile_collumn);
+                    matrix.prefetch_after(tile_row, tile_collumn);
+                    prefetch_after(tile_row, tile_collumn);
+                    gsl_matrix_add(tile.view(), other.view()); });
+  }
+
+  inline auto multiply(const TiledMatrix &lhs, const TiledMatrix &rhs, TiledMatrix &result) -> void
+  {
+    if ((lhs.m_numCollumns != rhs.m_numRows) || (result.m_numRows != lhs.m_numRows) || (result.m_numCollumns != rhs.m_numCollumns))
+      throw std::runtime_error{"Wrong matrix sizes!"};
+    if ((lhs.m_tileSize != rhs.m_tileSize) || (lhs.m_tileSize != result.m_tileSize))
+      throw std::runtime_error{"Multiplying tiled matrices with diffrent tile sizes"};
+    if (&result == &lhs || &result == &rhs)
+      throw std::runtime_error{"Result of tiled multiplication aliases an operand"};
+
+    const size_t inner = lhs.m_numTileCollumns;
+    for (size_t i = 0; i < result.m_numTileRows; i++)
+    {
+      for (size_t j = 0; j < result.m_numTileCollumns; j++)
+      {
+        TiledMatrix::Tile target = result.acquire(i, j, TiledMatrix::Access::Overwrite);
+        gsl_matrix_set_zero(target.view());
+
+        for (size_t k = 0; k < inner; k++)
+        {
+          TiledMatrix::Tile left = lhs.read_tile(i, k);
+          TiledMatrix::Tile right = rhs.read_tile(k, j);
+
+          // Loading the operands of the next step while this one computes
+          if (k + 1 < inner)
+          {
+            lhs.prefetch(i, k + 1);
+            rhs.prefetch(k + 1, j);
+          }
+          else
+          {
+            lhs.prefetch(j + 1 < result.m_numTileCollumns ? i : i + 1, 0);
+            rhs.prefetch(0, j + 1 < result.m_numTileCollumns ? j + 1 : 0);
+          }
+
+          bits::dgemm(CblasNoTrans, CblasNoTrans, 1.0, left.view(), right.view(), 1.0, target.view());
+        }
+      }
+    }
+  }
+
+  inline auto multiply(const TiledMatrix &matrix, const Vector &vec) -> Vector
+  {
+    if (matrix.m_numCollumns != vec.size())
+      throw std::runtime_error{"Wrong matrix sizes!"};
+
+    Vector result(matrix.m_numRows);
+    const size_t tile_size = matrix.m_tileSize;
+
+    matrix.for_each_tile([&](size_t tile_row, size_t tile_collumn)
+                         {
+                           TiledMatrix::Tile tile = matrix.read_tile(tile_row, tile_collumn);
+                           matrix.prefetch_after(tile_row, tile_collumn);
+                           gsl_matrix *view = tile.view();
+
+                           gsl_vector_view x = gsl_vector_subvector(vec.get_gsl_vector(), tile_collumn * tile_size, view->size2);
+                           gsl_vector_view y = gsl_vector_subvector(result.get_gsl_vector(), tile_row * tile_size, view->size1);
+                           gsl_blas_dgemv(CblasNoTrans, 1.0, view, &x.vector, 1.0, &y.vector); });
+
+    return result;
+  }
+
+  inline auto TiledMatrix::acquire(size_t tile_row, size_t tile_collumn, Access access) const -> Tile
+  {
+    if (tile_row >= m_numTileRows || tile_collumn >= m_numTileCollumns)
+      throw std::range_error{"Accesing tile out of bounds"};
+
+    Entry *entry = load(tile_row * m_numTileCollumns + tile_collumn, access, true);
+
+    const size_t rows = std::min(m_tileSize, m_numRows - tile_row * m_tileSize);
+    const size_t collumns = std::min(m_tileSize, m_numCollumns - tile_collumn * m_tileSize);
+    return Tile(this, entry, gsl_matrix_view_array_with_tda(entry->data.get(), rows, collumns, m_tileSize), access != Access::Read);
+  }
+
+  inline auto TiledMatrix::load(size_t key, Access access, bool pin) const -> Entry *
+  {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    while (true)
+    {
+      // The file holds stale data until an evicted copy is written back
+      if (m_writing.count(key) != 0)
+      {
+        m_changed.wait(lock);
+        continue;
+      }
+
+      auto found = m_index.find(key);
+      if (found == m_index.end())
+        break;
+
+      // Another thread is reading this tile right now
+      Entry &entry = *found->second;
+      if (!entry.ready)
+      {
+        m_changed.wait(lock);
+        continue;
+      }
+
+      m_entries.splice(m_entries.begin(), m_entries, found->second);
+      entry.pins += pin ? 1 : 0;
+      entry.dirty = entry.dirty || access != Access::Read;
+      return &entry;
+    }
+
+    std::list<Entry> victims;
+    evict_locked(victims);
+
+    const size_t tile_elements = m_tileSize * m_tileSize;
+    m_entries.push_front(Entry{key, std::make_unique<double[]>(tile_elements), 1, false, false});
+    auto position = m_entries.begin();
+    m_index.emplace(key, position);
+
+    // Writing back and reading happen unlocked, the new entry is pinned so
+    // it cannot be evicted
+    lock.unlock();
+    try
+    {
+      for (auto &&victim : victims)
+        write_to_file(victim.key, victim.data.get());
+      if (access != Access::Overwrite)
+        read_from_file(key, position->data.get());
+    }
+    catch (...)
+    {
+      lock.lock();
+      restore_locked(victims);
+      m_index.erase(key);
+      m_entries.erase(position);
+      m_changed.notify_all();
+      throw;
+    }
+    lock.lock();
+
+    for (auto &&victim : victims)
+      m_writing.erase(victim.key);
+    position->ready = true;
+    position->pins -= pin ? 0 : 1;
+    position->dirty = access != Access::Read;
+    m_changed.notify_all();
+    return &*position;
+  }
+
+  inline auto TiledMatrix::release(Entry *entry, bool write) const -> void
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    --entry->pins;
+    entry->dirty = entry->dirty || write;
+  }
+
+  inline auto TiledMatrix::evict_locked(std::list<Entry> &victims) const -> void
+  {
+    // Pinned and loading tiles stay, so the cache may briefly exceed its size.
+    // Dirty tiles move to victims for the caller to write back unlocked.
+    auto position = m_entries.end();
+    while (m_entries.size() >= m_capacity && position != m_entries.begin())
+    {
+      --position;
+      if (position->pins != 0 || !position->ready)
+        continue;
+
+      m_index.erase(position->key);
+      auto next = std::next(position);
+      if (position->dirty)
+      {
+        m_writing.insert(position->key);
+        victims.splice(victims.end(), m_entries, position);
+      }
+      else
+      {
+        m_entries.erase(position);
+      }
+      position = next;
+    }
+  }
+
+  inline auto TiledMatrix::restore_locked(std::list<Entry> &victims) const -> void
+  {
+    // Tiles that could not be written back return to the cache still dirty
+    for (auto victim = victims.begin(); victim != victims.end(); ++victim)
+    {
+      m_writing.erase(victim->key);
+      m_index.emplace(victim->key, victim);
+    }
+    m_entries.splice(m_entries.end(), victims);
+  }
+
+  inline auto TiledMatrix::read_from_file(size_t key, double *data) const -> void
+  {
+    const size_t tile_bytes = m_tileSize * m_tileSize * sizeof(double);
+    const off_t offset = static_cast<off_t>(key * tile_bytes);
+
+    size_t done = 0;
+    while (done < tile_bytes)
+    {
+      ssize_t count = ::pread(m_file, reinterpret_cast<char *>(data) + done, tile_bytes - done, offset + static_cast<off_t>(done));
+      if (count < 0)
+        throw std::runtime_error{"Reading tile failed"};
+      if (count == 0)
+        break;
+      done += static_cast<size_t>(count);
+    }
+    std::fill(reinterpret_cast<char *>(data) + done, reinterpret_cast<char *>(data) + tile_bytes, 0);
+  }
+
+  inline auto TiledMatrix::write_to_file(size_t key, const double *data) const -> void
+  {
+    const size_t tile_bytes = m_tileSize * m_tileSize * sizeof(double);
+    const off_t offset = static_cast<off_t>(key * tile_bytes);
+
+    size_t done = 0;
+    while (done < tile_bytes)
+    {
+      ssize_t count = ::pwrite(m_file, reinterpret_cast<const char *>(data) + done, tile_bytes - done, offset + static_cast<off_t>(done));
+      if (count <= 0)
+        throw std::runtime_error{"Writing tile failed"};
+      done += static_cast<size_t>(count);
+    }
+  }
+
+  inline auto TiledMatrix::prefetch_after(size_t tile_row, size_t tile_collumn) const -> void
+  {
+    if (tile_collumn + 1 < m_numTileCollumns)
+      prefetch(tile_row, tile_collumn + 1);
+    else
+      prefetch(tile_row + 1, 0);
+  }
+
+  inline auto TiledMatrix::for_each_tile(const std::function<void(size_t, size_t)> &body) const -> void
+  {
+    for (size_t tile_row = 0; tile_row < m_numTileRows; tile_row++)
+    {
+      for (size_t tile_collumn = 0; tile_collumn < m_numTileCollumns; tile_collumn++)
+      {
+        body(tile_row, tile_collumn);
+      }
+    }
+  }
+}
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <numeric>
 
 namespace gsl_wrapper::utils
@@ -22,4 +26,117 @@ namespace gsl_wrapper::utils
     return (std::fabs(d1 - d2) <= std::numeric_limits<double>::epsilon() * std::fmax(std::fabs(d1), std::fabs(d2)));
   }
 
-}
\ No newline at end of file
+  // Number of representable doubles between d1 and d2, NaN is infinitely far away
+  inline auto ulp_distance(const double d1, const double d2) -> std::uint64_t
+  {
+    if (std::isnan(d1) || std::isnan(d2))
+      return std::numeric_limits<std::uint64_t>::max();
+
+    // Mapping the bit patterns onto a monotonic unsigned scale, -0 and +0 coincide
+    constexpr std::uint64_t sign{std::uint64_t{1} << 63};
+    auto ordered = [sign](const double d)
+    {
+      std::uint64_t bits;
+      std::memcpy(&bits, &d, sizeof(bits));
+      return (bits & sign) ? sign - (bits & ~sign) : sign + bits;
+    };
+
+    const std::uint64_t o1{ordered(d1)};
+    const std::uint64_t o2{ordered(d2)};
+    return o1 > o2 ? o1 - o2 : o2 - o1;
+  }
+
+  // |d1 - d2| <= atol + rtol * max(|d1|, |d2|), written so loops over it vectorize.
+  // An infinite difference never passes, rtol * inf would accept it.
+  inline auto within_tolerance(const double d1, const double d2, const double rtol, const double atol) -> bool
+  {
+    const double a1{std::fabs(d1)};
+    const double a2{std::fabs(d2)};
+    const double difference{std::fabs(d1 - d2)};
+    return difference <= atol + rtol * (a1 > a2 ? a1 : a2) && difference < std::numeric_limits<double>::infinity();
+  }
+
+  // Equal infinities match even though their difference is NaN
+  inline auto approx_equal(const double d1, const double d2, const double rtol, const double atol, const std::uint64_t ulps) -> bool
+  {
+    return d1 == d2 || within_tolerance(d1, d2, rtol, atol) || (ulps != 0 && ulp_distance(d1, d2) <= ulps);
+  }
+
+  // Compares n strided elements, checking blocks without branches and
+  // returning at the first block holding a mismatch
+  inline auto approx_equal_n(const double *x1, const size_t stride1, const double *x2, const size_t stride2, const size_t n,
+                             const double rtol, const double atol, const std::uint64_t ulps) -> bool
+  {
+    constexpr size_t block{64};
+
+    size_t i = 0;
+    if (stride1 == 1 && stride2 == 1)
+    {
+      for (; i + block <= n; i += block)
+      {
+        // Counting instead of breaking keeps the inner loop vectorizable
+        size_t mismatches = 0;
+        for (size_t k = 0; k < block; k++)
+        {
+          mismatches += within_tolerance(x1[i + k], x2[i + k], rtol, atol) ? 0 : 1;
+        }
+
+        // Only a failing block pays for the ulp based check
+        if (mismatches != 0)
+        {
+          for (size_t k = 0; k < block; k++)
+          {
+            if (!approx_equal(x1[i + k], x2[i + k], rtol, atol, ulps))
+              return false;
+          }
+        }
+      }
+    }
+
+    for (; i < n; i++)
+    {
+      if (!approx_equal(x1[i * stride1], x2[i * stride2], rtol, atol, ulps))
+        return false;
+    }
+    return true;
+  }
+
+  // Worst differences found by compare(), worst_index is the row-major
+  // position of the element with the largest absolute error
+  struct Comparison
+  {
+    double max_abs_error;
+    double max_rel_error;
+    std::uint64_t max_ulps;
+    size_t worst_index;
+  };
+
+  // Folds n strided elements into `result`, numbering them from `first_index`
+  inline auto compare_n(const double *x1, const size_t stride1, const double *x2, const size_t stride2, const size_t n,
+                        const size_t first_index, Comparison &result) -> void
+  {
+    for (size_t i = 0; i < n; i++)
+    {
+      const double d1{x1[i * stride1]};
+      const double d2{x2[i * stride2]};
+      if (d1 == d2)
+        continue;
+
+      double abs_error{std::fabs(d1 - d2)};
+      if (std::isnan(abs_error))
+        abs_error = std::numeric_limits<double>::infinity();
+
+      const double scale{std::max(std::fabs(d1), std::fabs(d2))};
+      const double rel_error{scale == 0.0 ? 0.0 : abs_error / scale};
+
+      if (abs_error > result.max_abs_error)
+      {
+        result.max_abs_error = abs_error;
+        result.worst_index = first_index + i;
+      }
+      result.max_rel_error = std::max(result.max_rel_error, rel_error);
+      result.max_ulps = std::max(result.max_ulps, ulp_distance(d1, d2));
+    }
+  }
+
+}
@@ -4,19 +4,31 @@
 #include <iostream>
 #include <initializer_list>
 #include <exception>
+#include <limits>
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_linalg.h>
 
+#include "bits/random.h"
+#include "bits/shared-storage.h"
 #include "utils/fcmp.h"
 
+// Vectors with at most this many elements keep their data inside the object
+#ifndef GSL_WRAPPER_VECTOR_INLINE_CAPACITY
+#define GSL_WRAPPER_VECTOR_INLINE_CAPACITY 4
+#endif
+
 namespace gsl_wrapper
 {
 
   class Vector
   {
   public:
+    static constexpr size_t inline_capacity = GSL_WRAPPER_VECTOR_INLINE_CAPACITY;
+
     // Constructors and destructor
     Vector(size_t vec_size);
     Vector(gsl_vector *gsl_vec_ptr);
@@ -33,12 +45,39 @@ namespace gsl_wrapper
 
     ~Vector();
 
+    // Views data owned elsewhere without copying it, the data has to outlive
+    // the vector and copies of the view own their data again. Assigning to a
+    // view rebinds it to data of its own and never writes through, like
+    // Matrix::view.
+    static auto view(double *data, size_t vec_size, size_t stride = 1) -> Vector;
+
     // Member functions
+    auto get_gsl_vector() -> gsl_vector *;
     auto get_gsl_vector() const -> gsl_vector *;
     auto size() const -> size_t;
+    auto begin() -> double *;
     auto begin() const -> double *;
+    auto end() -> double *;
     auto end() const -> double *;
 
+    // Random fills, element i of the storage order depends only on the seed
+    // and i, whatever the number of threads doing the work
+    auto fill_uniform(std::uint64_t seed, double lower = 0.0, double upper = 1.0) -> void;
+    auto fill_gaussian(std::uint64_t seed, double mean = 0.0, double sigma = 1.0) -> void;
+    auto fill_exponential(std::uint64_t seed, double mean = 1.0) -> void;
+    auto fill_lognormal(std::uint64_t seed, double zeta = 0.0, double sigma = 1.0) -> void;
+
+    // Copies share data until one of them is modified, and assigning to a
+    // copy on write vector keeps it copy on write
+    //
+    // Sharing is not thread safe, the decision to copy before writing only
+    // looks at the reference count. Vectors sharing data must not be
+    // modified from different threads without synchronisation, and
+    // iterators taken before a copy still point at the shared data.
+    auto enable_copy_on_write() -> void;
+    auto is_copy_on_write() const -> bool;
+    auto shares_storage() const -> bool;
+
     // Operators
     auto operator=(const Vector &copy_from) -> Vector &;
     auto operator=(Vector &&move_from) -> Vector &;
@@ -58,14 +97,34 @@ namespace gsl_wrapper
     friend auto operator*(const double number, const Vector &vec) -> Vector;
 
   private:
+    Vector(const gsl_vector &header);
+
+    // Storage management
+    auto uses_header() const -> bool;
+    auto is_inline() const -> bool;
+    auto is_view() const -> bool;
+    auto allocate(size_t vec_size) -> void;
+    auto release() -> void;
+    auto take_storage(Vector &move_from) -> void;
+    auto share_storage(const Vector &copy_from) -> bool;
+    auto detach() -> void;
+
     gsl_vector *m_vector_ptr;
     size_t m_vector_size;
+
+    // Vectors not backed by their own gsl_vector point m_vector_ptr at this
+    // header. It views either m_inline_data or data kept alive by m_storage.
+    gsl_vector m_header;
+    double m_inline_data[inline_capacity > 0 ? inline_capacity : 1];
+    std::shared_ptr<double> m_storage;
+    bool m_copy_on_write = false;
   };
 
   inline Vector::Vector(size_t vec_size)
-      : m_vector_ptr{gsl_vector_calloc(vec_size)},
+      : m_vector_ptr{nullptr},
         m_vector_size{vec_size}
   {
+    allocate(vec_size);
   }
 
   inline Vector::Vector(gsl_vector *gsl_vec_ptr)
@@ -74,22 +133,42 @@ namespace gsl_wrapper
   {
   }
 
+  inline Vector::Vector(const gsl_vector &header)
+      : m_vector_ptr{&m_header},
+        m_vector_size{header.size},
+        m_header{header}
+  {
+  }
+
+  inline auto Vector::view(double *data, size_t vec_size, size_t stride) -> Vector
+  {
+    if (stride == 0)
+      throw std::range_error{"Vector view needs a non zero stride"};
+    return Vector(gsl_vector{vec_size, stride, data, nullptr, 0});
+  }
+
   inline Vector::Vector(const Vector &copy_from)
-      : m_vector_ptr{gsl_vector_calloc(copy_from.m_vector_size)},
+      : m_vector_ptr{nullptr},
         m_vector_size{copy_from.m_vector_size}
   {
+    if (share_storage(copy_from))
+      return;
+
+    allocate(m_vector_size);
     gsl_vector_memcpy(m_vector_ptr, copy_from.m_vector_ptr);
+    if (copy_from.m_copy_on_write)
+      enable_copy_on_write();
   }
 
   inline Vector::Vector(Vector &&move_from)
-      : m_vector_ptr{std::exchange(move_from.m_vector_ptr, nullptr)},
-        m_vector_size{std::exchange(move_from.m_vector_size, 0)}
+      : m_vector_ptr{nullptr},
+        m_vector_size{0}
   {
+    take_storage(move_from);
   }
 
   inline Vector::Vector(std::initializer_list<double> args)
-      : m_vector_ptr{gsl_vector_calloc(args.size())},
-        m_vector_size{args.size()}
+      : Vector(args.size())
   {
     size_t i = 0;
     for (auto &&el : args)
@@ -112,9 +191,171 @@ namespace gsl_wrapper
 
   inline Vector::~Vector()
   {
-    gsl_vector_free(m_vector_ptr);
+    release();
+  }
+
+  inline auto Vector::uses_header() const -> bool
+  {
+    return m_vector_ptr == &m_header;
+  }
+
+  inline auto Vector::is_inline() const -> bool
+  {
+    return uses_header() && m_header.data == m_inline_data;
+  }
+
+  inline auto Vector::is_view() const -> bool
+  {
+    return uses_header() && !is_inline() && !m_storage;
+  }
+
+  inline auto Vector::allocate(size_t vec_size) -> void
+  {
+    if (vec_size > inline_capacity)
+    {
+      m_vector_ptr = gsl_vector_calloc(vec_size);
+      return;
+    }
+
+    for (size_t i = 0; i < vec_size; i++)
+    {
+      m_inline_data[i] = 0.0;
+    }
+    m_header = gsl_vector{vec_size, 1, m_inline_data, nullptr, 0};
+    m_vector_ptr = &m_header;
   }
 
+  inline auto Vector::release() -> void
+  {
+    if (!uses_header())
+      gsl_vector_free(m_vector_ptr);
+    m_vector_ptr = nullptr;
+    m_storage.reset();
+  }
+
+  inline auto Vector::take_storage(Vector &move_from) -> void
+  {
+    m_vector_size = std::exchange(move_from.m_vector_size, 0);
+    m_copy_on_write = move_from.m_copy_on_write;
+
+    // Heap storage changes hands, inline storage has to be copied over
+    if (!move_from.uses_header())
+    {
+      m_vector_ptr = std::exchange(move_from.m_vector_ptr, nullptr);
+      return;
+    }
+
+    if (move_from.is_inline())
+    {
+      allocate(m_vector_size);
+      for (size_t i = 0; i < m_vector_size; i++)
+      {
+        m_inline_data[i] = move_from.m_inline_data[i];
+      }
+    }
+    else
+    {
+      m_header = move_from.m_header;
+      m_storage = std::move(move_from.m_storage);
+      m_vector_ptr = &m_header;
+    }
+    move_from.m_vector_ptr = nullptr;
+  }
+
+  inline auto Vector::share_storage(const Vector &copy_from) -> bool
+  {
+    if (!copy_from.m_copy_on_write || !copy_from.m_storage)
+      return false;
+
+    m_header = copy_from.m_header;
+    m_storage = copy_from.m_storage;
+    m_vector_ptr = &m_header;
+    m_vector_size = copy_from.m_vector_size;
+    m_copy_on_write = true;
+    return true;
+  }
+
+  inline auto Vector::detach() -> void
+  {
+    if (!m_storage || m_storage.use_count() == 1)
+      return;
+
+    // Someone else still reads the shared data, so this vector gets its own copy
+    auto storage = bits::allocate_block(m_vector_size);
+    gsl_vector copy{m_vector_size, 1, storage.get(), nullptr, 0};
+    gsl_vector_memcpy(&copy, &m_header);
+
+    m_header = copy;
+    m_storage = std::move(storage);
+  }
+
+  inline auto Vector::fill_uniform(std::uint64_t seed, double lower, double upper) -> void
+  {
+    if (m_vector_size == 0)
+      return;
+    gsl_vector *vector = get_gsl_vector();
+    bits::random_fill_rows(seed, bits::RandomDistribution::Uniform, m_vector_size, 1, vector->data, vector->stride, vector->stride, bits::uniform_pair(lower, upper));
+  }
+
+  inline auto Vector::fill_gaussian(std::uint64_t seed, double mean, double sigma) -> void
+  {
+    if (m_vector_size == 0)
+      return;
+    gsl_vector *vector = get_gsl_vector();
+    bits::random_fill_rows(seed, bits::RandomDistribution::Gaussian, m_vector_size, 1, vector->data, vector->stride, vector->stride, bits::gaussian_pair(mean, sigma));
+  }
+
+  inline auto Vector::fill_exponential(std::uint64_t seed, double mean) -> void
+  {
+    if (m_vector_size == 0)
+      return;
+    gsl_vector *vector = get_gsl_vector();
+    bits::random_fill_rows(seed, bits::RandomDistribution::Exponential, m_vector_size, 1, vector->data, vector->stride, vector->stride, bits::exponential_pair(mean));
+  }
+
+  inline auto Vector::fill_lognormal(std::uint64_t seed, double zeta, double sigma) -> void
+  {
+    if (m_vector_size == 0)
+      return;
+    gsl_vector *vector = get_gsl_vector();
+    bits::random_fill_rows(seed, bits::RandomDistribution::Lognormal, m_vector_size, 1, vector->data, vector->stride, vector->stride, bits::lognormal_pair(zeta, sigma));
+  }
+
+  inline auto Vector::enable_copy_on_write() -> void
+  {
+    m_copy_on_write = true;
+    if (m_vector_ptr == nullptr || uses_header())
+      return;
+
+    // Handing the gsl_block over to reference counted storage
+    gsl_vector *owned = m_vector_ptr;
+    if (owned->owner)
+    {
+      m_storage = bits::adopt_block(owned->block, owned->data);
+      owned->owner = 0;
+    }
+    m_header = gsl_vector{owned->size, owned->stride, owned->data, nullptr, 0};
+    m_vector_ptr = &m_header;
+    gsl_vector_free(owned);
+  }
+
+  inline auto Vector::is_copy_on_write() const -> bool
+  {
+    return m_copy_on_write;
+  }
+
+  inline auto Vector::shares_storage() const -> bool
+  {
+    return m_storage && m_storage.use_count() > 1;
+  }
+
+  inline auto Vector::get_gsl_vector() -> gsl_vector *
+  {
+    detach();
+    return m_vector_ptr;
+  }
+
+  // Writing through the pointer of a const vector bypasses copy on write
   inline auto Vector::get_gsl_vector() const -> gsl_vector *
   {
     return m_vector_ptr;
@@ -125,11 +366,23 @@ namespace gsl_wrapper
     return m_vector_size;
   }
 
+  inline auto Vector::begin() -> double *
+  {
+    detach();
+    return m_vector_ptr->data;
+  }
+
   inline auto Vector::begin() const -> double *
   {
     return m_vector_ptr->data;
   }
 
+  inline auto Vector::end() -> double *
+  {
+    detach();
+    return m_vector_ptr->data + m_vector_size;
+  }
+
   inline auto Vector::end() const -> double *
   {
     return m_vector_ptr->data + m_vector_size;
@@ -141,10 +394,26 @@ namespace gsl_wrapper
     if (m_vector_ptr == copy_from.m_vector_ptr)
       return *this;
 
-    gsl_vector_free(m_vector_ptr);
-    m_vector_ptr = gsl_vector_calloc(copy_from.m_vector_size);
+    if (copy_from.m_copy_on_write && copy_from.m_storage)
+    {
+      release();
+      share_storage(copy_from);
+      return *this;
+    }
+
+    // Reuse current storage when the sizes already match and nobody shares
+    // it. Views are rebound rather than written through.
+    if (m_vector_ptr == nullptr || m_vector_size != copy_from.m_vector_size || shares_storage() || is_view())
+    {
+      release();
+      allocate(copy_from.m_vector_size);
+      m_vector_size = copy_from.m_vector_size;
+    }
     gsl_vector_memcpy(m_vector_ptr, copy_from.m_vector_ptr);
-    m_vector_size = copy_from.m_vector_size;
+
+    m_copy_on_write = m_copy_on_write || copy_from.m_copy_on_write;
+    if (m_copy_on_write)
+      enable_copy_on_write();
 
     return *this;
   }
@@ -155,25 +424,46 @@ namespace gsl_wrapper
     if (m_vector_ptr == move_from.m_vector_ptr)
       return *this;
 
-    gsl_vector_free(m_vector_ptr);
-    m_vector_ptr = std::exchange(move_from.m_vector_ptr, nullptr);
-    m_vector_size = std::exchange(move_from.m_vector_size, 0);
+    release();
+    take_storage(move_from);
 
     return *this;
   }
 
-  inline auto Vector::operator==(const Vector &comparasion_vector) -> bool
+  // Elementwise comparison, elements match within rtol * max(|a|, |b|) + atol or `ulps` units in the last place
+  inline auto approx_equal(const Vector &first, const Vector &second,
+                           const double rtol = std::numeric_limits<double>::epsilon(),
+                           const double atol = 0.0, const std::uint64_t ulps = 0) -> bool
   {
-    if (m_vector_size != comparasion_vector.m_vector_size)
+    if (first.size() != second.size())
       return false;
+    if (first.size() == 0)
+      return true;
 
-    for (size_t i = 0; i < m_vector_size; i++)
-    {
-      bool test = ::gsl_wrapper::utils::equal((*this)[i], comparasion_vector[i]);
-      if (!test)
-        return false;
-    }
-    return true;
+    const gsl_vector *x1 = first.get_gsl_vector();
+    const gsl_vector *x2 = second.get_gsl_vector();
+    return ::gsl_wrapper::utils::approx_equal_n(x1->data, x1->stride, x2->data, x2->stride, first.size(), rtol, atol, ulps);
+  }
+
+  // Largest absolute, relative and ulp differences in a single pass
+  inline auto compare(const Vector &first, const Vector &second) -> ::gsl_wrapper::utils::Comparison
+  {
+    if (first.size() != second.size())
+      throw std::range_error{"Comparing vectors of diffrent sizes"};
+
+    ::gsl_wrapper::utils::Comparison result{0.0, 0.0, 0, 0};
+    if (first.size() == 0)
+      return result;
+
+    const gsl_vector *x1 = first.get_gsl_vector();
+    const gsl_vector *x2 = second.get_gsl_vector();
+    ::gsl_wrapper::utils::compare_n(x1->data, x1->stride, x2->data, x2->stride, first.size(), 0, result);
+    return result;
+  }
+
+  inline auto Vector::operator==(const Vector &comparasion_vector) -> bool
+  {
+    return approx_equal(*this, comparasion_vector);
   }
 
   inline auto Vector::operator!=(const Vector &comparasion_vector) -> bool
@@ -185,6 +475,7 @@ namespace gsl_wrapper
   {
     if (index >= m_vector_size)
       throw std::range_error{"Accesing vector elements out of bounds"};
+    detach();
     return *gsl_vector_ptr(m_vector_ptr, index);
   }
 
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include <mdspan>
+#include <stdexcept>
+#include <type_traits>
+
+#include <gsl_wrapper/interop.h>
+
+using gsl_wrapper::Matrix;
+using gsl_wrapper::Vector;
+
+static_assert(GSL_WRAPPER_HAS_MDSPAN, "The C++23 tests need the std::mdspan adapters");
+
+TEST(MdspanTest, MatrixSpan)
+{
+  // 2 x 3 matrix inside rows of 4
+  double data[] = {1, 2, 3, -1, 4, 5, 6, -1};
+  Matrix view = Matrix::view(data, 2, 3, 4);
+
+  auto span = gsl_wrapper::as_mdspan(view);
+  ASSERT_EQ(span.extent(0), 2);
+  ASSERT_EQ(span.extent(1), 3);
+  ASSERT_EQ(span.stride(0), 4);
+  ASSERT_EQ((span[1, 2]), 6);
+  span[0, 1] = 20;
+  ASSERT_EQ(view[0][1], 20);
+
+  const Matrix &constant = view;
+  auto const_span = gsl_wrapper::as_mdspan(constant);
+  static_assert(std::is_same_v<decltype(const_span), gsl_wrapper::ConstMatrixSpan>);
+  ASSERT_EQ((const_span[0, 1]), 20);
+
+  Matrix adopted = gsl_wrapper::from_mdspan(span);
+  ASSERT_EQ(adopted.get_gsl_matrix()->data, data);
+  ASSERT_EQ(adopted.get_gsl_matrix()->tda, 4);
+
+  std::mdspan<double, std::dextents<size_t, 2>, std::layout_left> collumn_major{data, 2, 3};
+  ASSERT_THROW(gsl_wrapper::from_mdspan(collumn_major), std::runtime_error);
+}
+
+TEST(MdspanTest, VectorSpan)
+{
+  double data[] = {1, -1, 2, -1, 3, -1};
+  Vector view = Vector::view(data, 3, 2);
+
+  auto span = gsl_wrapper::as_mdspan(view);
+  ASSERT_EQ(span.extent(0), 3);
+  ASSERT_EQ(span.stride(0), 2);
+  span[1] = 20;
+  ASSERT_EQ(data[2], 20);
+
+  Vector adopted = gsl_wrapper::vector_from_mdspan(span);
+  ASSERT_EQ(adopted.get_gsl_vector()->data, data);
+  ASSERT_EQ(adopted.get_gsl_vector()->stride, 2);
+}
+
+TEST(MdspanTest, Rows)
+{
+  double data[] = {1, 2, 3, -1, 4, 5, 6, -1};
+  Matrix view = Matrix::view(data, 2, 3, 4);
+
+  auto row = gsl_wrapper::as_mdspan(view[1]);
+  row[0] = 40;
+  ASSERT_EQ(data[4], 40);
+
+  Vector vector = gsl_wrapper::vector_from_mdspan(row);
+  ASSERT_EQ(vector.size(), 3);
+  ASSERT_EQ(vector.get_gsl_vector()->data, data + 4);
+
+  // Rows of a const matrix are only readable
+  const Matrix &constant = view;
+  auto const_row = gsl_wrapper::as_mdspan(constant[1]);
+  static_assert(std::is_same_v<decltype(const_row), gsl_wrapper::ConstVectorSpan>);
+  ASSERT_EQ(const_row[2], 6);
+}
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <future>
+
+#include <gsl_wrapper/deferred.h>
+
+using gsl_wrapper::Matrix;
+using gsl_wrapper::Vector;
+using gsl_wrapper::deferred::Expression;
+using gsl_wrapper::deferred::Graph;
+
+TEST(DeferredTest, MatchesEagerResult)
+{
+  Matrix first{{0.11, 0.12, 0.13}, {0.21, 0.22, 0.23}};
+  Matrix second{{1011., 1012.}, {1021., 1022.}, {1031., 1031.}};
+  Matrix third{{1, 2}, {3, 4}};
+
+  Graph graph;
+  Expression a = graph.input(first);
+  Expression b = graph.input(second);
+  Expression c = graph.input(third);
+
+  Expression product = a * b;
+  Expression result = 2 * (product + c) + 1.5;
+
+  Matrix expected = 2 * (first * second + third) + 1.5;
+  ASSERT_TRUE(result.evaluate() == expected);
+  ASSERT_EQ(result.get_dimensions().first, 2);
+  ASSERT_EQ(result.get_dimensions().second, 2);
+
+  Matrix converted = product;
+  ASSERT_TRUE(converted == first * second);
+}
+
+TEST(DeferredTest, IndependentExpressions)
+{
+  Matrix base{{1, 2}, {3, 4}};
+  Graph graph;
+  Expression input = graph.input(base);
+
+  std::vector<Expression> results;
+  for (int i = 1; i <= 16; i++)
+  {
+    results.push_back(input * input * static_cast<double>(i));
+  }
+  graph.evaluate(results);
+
+  Matrix square = base * base;
+  for (int i = 1; i <= 16; i++)
+  {
+    ASSERT_TRUE(results[i - 1].evaluate() == square * i);
+  }
+}
+
+TEST(DeferredTest, CommonSubexpressions)
+{
+  Matrix base(3);
+  Graph graph;
+
+  Expression first = graph.input(base) * graph.input(base);
+  size_t num_nodes = graph.num_nodes();
+  Expression second = graph.input(base) * graph.input(base);
+
+  ASSERT_EQ(graph.num_nodes(), num_nodes);
+  ASSERT_EQ(&first.evaluate(), &second.evaluate());
+}
+
+TEST(DeferredTest, VectorInput)
+{
+  Matrix base{{1, 2}, {3, 4}};
+  Vector column{1, 1};
+
+  Graph graph;
+  Matrix result = graph.input(base) * graph.input(column);
+
+  ASSERT_TRUE(result == Matrix({{3}, {7}}));
+}
+
+TEST(DeferredTest, WrongSizes)
+{
+  Matrix first(2, 3);
+  Matrix second(2, 3);
+  Matrix third(3, 3);
+  Graph graph;
+
+  EXPECT_THROW({ graph.input(first) * graph.input(second); }, std::runtime_error);
+  EXPECT_THROW({ graph.input(first) + graph.input(third); }, std::range_error);
+}
+
+TEST(DeferredTest, InputsAreCopied)
+{
+  Matrix base{{1, 2}, {3, 4}};
+  Graph graph;
+
+  Expression before = graph.input(base) * 2.0;
+  ASSERT_EQ(before.evaluate()[0][0], 2);
+
+  // Changed contents make a new input node, the old result stays
+  base[0][0] = 10;
+  Expression after = graph.input(base) * 2.0;
+  ASSERT_EQ(after.evaluate()[0][0], 20);
+  ASSERT_EQ(before.evaluate()[0][0], 2);
+
+  // Temporaries can be entered as well
+  Expression temporary = graph.input(Matrix{{5, 6}, {7, 8}}) + 1.0;
+  ASSERT_EQ(temporary.evaluate()[1][1], 9);
+}
+
+TEST(DeferredTest, EvaluateFromPoolTask)
+{
+  // The only worker evaluates the graph, so it has to run the nodes itself
+  gsl_wrapper::bits::ThreadPool pool(1);
+  Matrix base{{1, 2}, {3, 4}};
+  Graph graph(pool);
+  Expression input = graph.input(base);
+  Expression result = (input * input + 1.0) * input;
+
+  std::promise<Matrix> promise;
+  std::future<Matrix> value = promise.get_future();
+  pool.submit([&]
+              { promise.set_value(result.evaluate()); });
+  ASSERT_EQ(value.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+  ASSERT_TRUE(value.get() == (base * base + 1.0) * base);
+}
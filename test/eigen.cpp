@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <stdexcept>
+
+#include <gsl_wrapper/eigen.h>
+
+using gsl_wrapper::Matrix;
+using gsl_wrapper::NonsymmetricEigen;
+using gsl_wrapper::SymmetricEigen;
+
+namespace
+{
+  // Largest |(A v - lambda v)_i| over all eigenpairs
+  auto eigen_residual(const Matrix &matrix, const Matrix &vectors, const gsl_wrapper::Vector &values) -> double
+  {
+    const size_t size = matrix.num_rows();
+    double result = 0.0;
+    for (size_t k = 0; k < size; k++)
+    {
+      for (size_t i = 0; i < size; i++)
+      {
+        double sum = 0.0;
+        for (size_t j = 0; j < size; j++)
+        {
+          sum += matrix[i][j] * vectors[j][k];
+        }
+        result = std::fmax(result, std::fabs(sum - values[k] * vectors[i][k]));
+      }
+    }
+    return result;
+  }
+}
+
+TEST(EigenTest, Symmetric)
+{
+  Matrix matrix = {{2, -1, 0}, {-1, 2, -1}, {0, -1, 2}};
+  SymmetricEigen eigen(matrix);
+
+  ASSERT_EQ(eigen.size(), 3);
+  ASSERT_TRUE(eigen.has_eigenvectors());
+  EXPECT_NEAR(eigen.eigenvalues()[0], 2.0 - std::sqrt(2.0), 1e-12);
+  EXPECT_NEAR(eigen.eigenvalues()[1], 2.0, 1e-12);
+  EXPECT_NEAR(eigen.eigenvalues()[2], 2.0 + std::sqrt(2.0), 1e-12);
+  EXPECT_LT(eigen_residual(matrix, eigen.eigenvectors(), eigen.eigenvalues()), 1e-12);
+
+  // The input is left untouched
+  ASSERT_EQ(matrix[1][1], 2.0);
+}
+
+TEST(EigenTest, SymmetricInPlace)
+{
+  Matrix matrix = {{4, 1}, {1, 4}};
+  SymmetricEigen values_only(Matrix(matrix), false);
+  SymmetricEigen eigen(std::move(matrix));
+
+  ASSERT_FALSE(values_only.has_eigenvectors());
+  ASSERT_THROW(values_only.eigenvectors(), std::runtime_error);
+  EXPECT_NEAR(values_only.eigenvalues()[0], 3.0, 1e-12);
+  EXPECT_NEAR(values_only.eigenvalues()[1], 5.0, 1e-12);
+  EXPECT_NEAR(eigen.eigenvalues()[0], 3.0, 1e-12);
+  EXPECT_NEAR(eigen.eigenvalues()[1], 5.0, 1e-12);
+
+  // The consumed input is left empty
+  ASSERT_EQ(matrix.num_rows(), 0);
+}
+
+TEST(EigenTest, NonsymmetricRealEigenvalues)
+{
+  Matrix matrix = {{1, 2, 3}, {0, 4, 5}, {0, 0, -6}};
+  NonsymmetricEigen eigen(matrix, false);
+
+  ASSERT_TRUE(eigen.is_real());
+  EXPECT_NEAR(eigen.eigenvalues_real()[0], -6.0, 1e-12);
+  EXPECT_NEAR(eigen.eigenvalues_real()[1], 4.0, 1e-12);
+  EXPECT_NEAR(eigen.eigenvalues_real()[2], 1.0, 1e-12);
+  ASSERT_THROW(eigen.eigenvectors_real(), std::runtime_error);
+}
+
+TEST(EigenTest, NonsymmetricEigenvectors)
+{
+  Matrix matrix = {{1, 2, 3}, {0, 4, 5}, {0, 0, -6}};
+  NonsymmetricEigen eigen(matrix);
+
+  ASSERT_TRUE(eigen.has_eigenvectors());
+  EXPECT_LT(eigen_residual(matrix, eigen.eigenvectors_real(), eigen.eigenvalues_real()), 1e-12);
+}
+
+TEST(EigenTest, NonsymmetricComplexEigenvalues)
+{
+  // Rotation by a quarter turn has eigenvalues +i and -i
+  NonsymmetricEigen eigen(Matrix{{0, -1}, {1, 0}});
+
+  ASSERT_FALSE(eigen.is_real());
+  EXPECT_NEAR(eigen.eigenvalues_real()[0], 0.0, 1e-12);
+  EXPECT_NEAR(eigen.eigenvalues_real()[1], 0.0, 1e-12);
+  EXPECT_NEAR(std::fabs(eigen.eigenvalues_imag()[0]), 1.0, 1e-12);
+  EXPECT_NEAR(eigen.eigenvalues_imag()[0] + eigen.eigenvalues_imag()[1], 0.0, 1e-12);
+}
+
+TEST(EigenTest, NonSquareMatrix)
+{
+  Matrix matrix(2, 3);
+  ASSERT_THROW(SymmetricEigen{matrix}, std::range_error);
+  ASSERT_THROW(NonsymmetricEigen{matrix}, std::range_error);
+}
+
+TEST(EigenTest, WorkspaceReuse)
+{
+  using Workspaces = gsl_wrapper::bits::SymmvWorkspaces;
+
+  Matrix matrix = {{2, 1, 0, 0, 0}, {1, 2, 1, 0, 0}, {0, 1, 2, 1, 0}, {0, 0, 1, 2, 1}, {0, 0, 0, 1, 2}};
+  Workspaces::clear();
+  {
+    auto lease = Workspaces::acquire(5);
+    ASSERT_EQ(Workspaces::idle_count(5), 0);
+  }
+  ASSERT_EQ(Workspaces::idle_count(5), 1);
+
+  // Decompositions of the same size keep taking the idle workspace back
+  for (int i = 0; i < 3; i++)
+  {
+    SymmetricEigen eigen(matrix);
+  }
+  ASSERT_EQ(Workspaces::idle_count(5), 1);
+
+  Workspaces::clear();
+  ASSERT_EQ(Workspaces::idle_count(5), 0);
+
+  // Only max_sizes sizes keep idle workspaces
+  for (size_t size = 1; size <= 2 * Workspaces::max_sizes; size++)
+  {
+    Workspaces::acquire(size);
+  }
+  size_t cached = 0;
+  for (size_t size = 1; size <= 2 * Workspaces::max_sizes; size++)
+  {
+    cached += Workspaces::idle_count(size);
+  }
+  ASSERT_EQ(cached, Workspaces::max_sizes);
+  Workspaces::clear();
+}
+
+namespace
+{
+  auto noop_handler(const char *, const char *, int, int) -> void
+  {
+  }
+}
+
+TEST(EigenTest, ErrorHandlerRestored)
+{
+  // The handler is only switched off while the decomposition runs
+  gsl_error_handler_t *previous = gsl_set_error_handler(noop_handler);
+  SymmetricEigen eigen(Matrix{{2, 1}, {1, 2}});
+  ASSERT_EQ(gsl_set_error_handler(previous), noop_handler);
+}
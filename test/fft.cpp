@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+
+#include <gsl_wrapper/fft.h>
+
+using gsl_wrapper::FFT;
+using gsl_wrapper::Matrix;
+using gsl_wrapper::Vector;
+
+namespace
+{
+  // Naive DFT of real input as interleaved complex coefficients
+  auto real_dft(const Vector &x) -> Vector
+  {
+    const size_t n = x.size();
+    Vector result(2 * n);
+    for (size_t k = 0; k < n; k++)
+    {
+      double re = 0.0;
+      double im = 0.0;
+      for (size_t j = 0; j < n; j++)
+      {
+        const double angle = -2.0 * M_PI * double(j * k % n) / double(n);
+        re += x[j] * std::cos(angle);
+        im += x[j] * std::sin(angle);
+      }
+      result[2 * k] = re;
+      result[2 * k + 1] = im;
+    }
+    return result;
+  }
+
+  auto expect_near(const Vector &actual, const Vector &expected, double tolerance) -> void
+  {
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); i++)
+    {
+      ASSERT_NEAR(actual[i], expected[i], tolerance);
+    }
+  }
+}
+
+TEST(FFTTest, RealTransform)
+{
+  for (size_t n : {1, 2, 7, 12, 30})
+  {
+    Vector x(n);
+    x.fill_uniform(n, -1.0, 1.0);
+    const Vector original = x;
+
+    FFT::real(x);
+    expect_near(FFT::unpack(x), real_dft(original), 1e-10);
+
+    FFT::real(x, FFT::Direction::Inverse);
+    expect_near(x, original, 1e-12);
+  }
+}
+
+TEST(FFTTest, ComplexTransform)
+{
+  Vector x(2 * 10);
+  x.fill_uniform(5, -1.0, 1.0);
+  const Vector original = x;
+
+  // A complex transform of real data agrees with the real transform
+  Vector real_part(10);
+  for (size_t i = 0; i < 10; i++)
+  {
+    x[2 * i + 1] = 0.0;
+    real_part[i] = x[2 * i];
+  }
+  FFT::complex(x);
+  expect_near(x, real_dft(real_part), 1e-10);
+
+  x = original;
+  FFT::complex(x);
+  FFT::complex(x, FFT::Direction::Inverse);
+  expect_near(x, original, 1e-12);
+
+  Vector odd(7);
+  ASSERT_THROW(FFT::complex(odd), std::range_error);
+}
+
+TEST(FFTTest, StridedVectors)
+{
+  double storage[16];
+  for (size_t i = 0; i < 16; i++)
+  {
+    storage[i] = double(i % 5) - 2.0;
+  }
+
+  Vector strided = Vector::view(storage, 8, 2);
+  const Vector original = strided;
+  FFT::real(strided);
+
+  Vector complex(16);
+  FFT::unpack(strided, complex);
+  expect_near(complex, real_dft(original), 1e-10);
+
+  // Elements between the strided ones are untouched
+  ASSERT_EQ(storage[1], -1.0);
+  ASSERT_EQ(storage[15], -2.0);
+}
+
+TEST(FFTTest, Rows)
+{
+  // Large enough to be split between threads
+  Matrix signals(300, 120);
+  signals.fill_uniform(11, -1.0, 1.0);
+  const Matrix original = signals;
+
+  FFT::real_rows(signals);
+  Matrix unpacked = FFT::unpack_rows(signals);
+  ASSERT_EQ(unpacked.num_collumns(), 240);
+  for (size_t i = 0; i < 300; i += 37)
+  {
+    Vector row(120);
+    for (size_t j = 0; j < 120; j++)
+    {
+      row[j] = original[i][j];
+    }
+    Vector expected = real_dft(row);
+    for (size_t j = 0; j < 240; j++)
+    {
+      ASSERT_NEAR(unpacked[i][j], expected[j], 1e-9);
+    }
+  }
+
+  FFT::real_rows(signals, FFT::Direction::Inverse);
+  ASSERT_TRUE(gsl_wrapper::approx_equal(signals, original, 0.0, 1e-12));
+
+  // Complex rows of interleaved pairs
+  FFT::complex_rows(unpacked, FFT::Direction::Inverse);
+  for (size_t j = 0; j < 120; j++)
+  {
+    ASSERT_NEAR(unpacked[5][2 * j], original[5][j], 1e-12);
+    ASSERT_NEAR(unpacked[5][2 * j + 1], 0.0, 1e-12);
+  }
+}
+
+TEST(FFTTest, Collumns)
+{
+  Matrix signals(40, 19);
+  signals.fill_uniform(3, -1.0, 1.0);
+  const Matrix original = signals;
+
+  FFT::real_collumns(signals);
+  for (size_t j = 0; j < 19; j++)
+  {
+    Vector expected(40);
+    for (size_t i = 0; i < 40; i++)
+    {
+      expected[i] = original[i][j];
+    }
+    FFT::real(expected);
+    for (size_t i = 0; i < 40; i++)
+    {
+      ASSERT_NEAR(signals[i][j], expected[i], 1e-12);
+    }
+  }
+
+  FFT::real_collumns(signals, FFT::Direction::Inverse);
+  ASSERT_TRUE(gsl_wrapper::approx_equal(signals, original, 0.0, 1e-12));
+}
+
+TEST(FFTTest, PlanCache)
+{
+  FFT::clear_cache();
+  ASSERT_EQ(gsl_wrapper::bits::RealWavetables::idle_count(24), 0);
+
+  Vector x(24);
+  x.fill_uniform(1);
+  FFT::real(x);
+  FFT::real(x);
+  ASSERT_EQ(gsl_wrapper::bits::RealWavetables::idle_count(24), 1);
+  ASSERT_EQ(gsl_wrapper::bits::RealWorkspaces::idle_count(24), 1);
+
+  FFT::clear_cache();
+  ASSERT_EQ(gsl_wrapper::bits::RealWavetables::idle_count(24), 0);
+
+  // Workers of the shared pool cache their own plans, clearing frees them too
+  auto idle_on_workers = []
+  {
+    std::atomic<size_t> idle{0};
+    auto &pool = gsl_wrapper::bits::ThreadPool::shared();
+    pool.parallel_for(4 * pool.size(), [&](size_t, size_t)
+                      { idle += gsl_wrapper::bits::RealWavetables::idle_count(120); });
+    return idle.load();
+  };
+  Matrix signals(300, 120);
+  signals.fill_uniform(7);
+  FFT::real_rows(signals);
+  ASSERT_GT(idle_on_workers(), 0);
+  FFT::clear_cache();
+  ASSERT_EQ(idle_on_workers(), 0);
+}
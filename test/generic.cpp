@@ -38,4 +38,94 @@ TEST(Generic, DoubleComparision)
     double d2 = 3.45e-90;
     EXPECT_FALSE(equal(d1, d2));
   }
-}
\ No newline at end of file
+}
+
+TEST(Generic, UlpDistance)
+{
+  using gsl_wrapper::utils::ulp_distance;
+
+  EXPECT_EQ(ulp_distance(1.0, 1.0), 0);
+  EXPECT_EQ(ulp_distance(1.0, std::nextafter(1.0, 2.0)), 1);
+  EXPECT_EQ(ulp_distance(0.0, -0.0), 0);
+  EXPECT_EQ(ulp_distance(-std::numeric_limits<double>::denorm_min(), std::numeric_limits<double>::denorm_min()), 2);
+  EXPECT_EQ(ulp_distance(1.0, NAN), std::numeric_limits<std::uint64_t>::max());
+}
+
+TEST(Generic, ApproxEqual)
+{
+  using gsl_wrapper::approx_equal;
+
+  Vector first(100);
+  for (size_t i = 0; i < 100; i++)
+  {
+    first[i] = i * 0.1;
+  }
+
+  Vector second = first;
+  ASSERT_TRUE(approx_equal(first, second));
+
+  second[57] += 1e-9;
+  EXPECT_FALSE(approx_equal(first, second));
+  EXPECT_TRUE(approx_equal(first, second, 0.0, 1e-8));
+  EXPECT_FALSE(approx_equal(first, second, 1e-12));
+
+  second[57] = std::nextafter(first[57], 10.0);
+  EXPECT_FALSE(approx_equal(first, second, 0.0));
+  EXPECT_TRUE(approx_equal(first, second, 0.0, 0.0, 1));
+
+  EXPECT_FALSE(approx_equal(first, Vector(99)));
+
+  Matrix matrix{{1, 2, 3}, {4, 5, 6}};
+  Matrix other = matrix;
+  other[1][0] = 4.5;
+  EXPECT_TRUE(approx_equal(matrix, matrix));
+  EXPECT_FALSE(approx_equal(matrix, other));
+  EXPECT_TRUE(approx_equal(matrix, other, 0.2));
+
+  // Equal infinities match, opposite ones and NaN do not
+  const double inf = std::numeric_limits<double>::infinity();
+  EXPECT_TRUE(approx_equal(Vector{inf, -inf, 1.0}, Vector{inf, -inf, 1.0}));
+  EXPECT_FALSE(approx_equal(Vector{inf}, Vector{-inf}));
+  EXPECT_FALSE(approx_equal(Vector{inf}, Vector{1.0}, 0.5));
+  EXPECT_FALSE(approx_equal(Vector{NAN}, Vector{NAN}));
+
+  // Moved from vectors are empty
+  Vector moved = std::move(first);
+  Vector also_moved = std::move(second);
+  EXPECT_TRUE(approx_equal(first, second));
+  EXPECT_FALSE(approx_equal(first, moved));
+}
+
+TEST(Generic, Compare)
+{
+  using gsl_wrapper::compare;
+
+  Matrix matrix{{1, 2, 3}, {4, 5, 6}};
+  Matrix other = matrix;
+  other[0][1] = 2.5;
+  other[1][2] = std::nextafter(6.0, 0.0);
+
+  auto result = compare(matrix, other);
+  EXPECT_DOUBLE_EQ(result.max_abs_error, 0.5);
+  EXPECT_DOUBLE_EQ(result.max_rel_error, 0.2);
+  EXPECT_EQ(result.worst_index, 1);
+  EXPECT_GT(result.max_ulps, 1);
+
+  Vector first{1, 2, 3};
+  Vector second{1, 2, 3.25};
+  auto vector_result = compare(first, second);
+  EXPECT_DOUBLE_EQ(vector_result.max_abs_error, 0.25);
+  EXPECT_EQ(vector_result.worst_index, 2);
+
+  EXPECT_THROW({ compare(first, Vector(2)); }, std::range_error);
+
+  const double inf = std::numeric_limits<double>::infinity();
+  auto infinite = compare(Vector{inf, 1.0}, Vector{inf, 1.5});
+  EXPECT_DOUBLE_EQ(infinite.max_abs_error, 0.5);
+  EXPECT_EQ(infinite.max_ulps, gsl_wrapper::utils::ulp_distance(1.0, 1.5));
+  EXPECT_EQ(infinite.worst_index, 1);
+
+  Vector large(100);
+  Vector moved = std::move(large);
+  EXPECT_EQ(compare(large, large).max_abs_error, 0.0);
+}
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include <type_traits>
+#include <utility>
+
+#include <gsl_wrapper/interop.h>
+
+using gsl_wrapper::Matrix;
+using gsl_wrapper::Vector;
+
+TEST(InteropTest, MatrixView)
+{
+  // 2 x 3 matrix inside rows of 4
+  double data[] = {1, 2, 3, -1, 4, 5, 6, -1};
+  Matrix view = Matrix::view(data, 2, 3, 4);
+
+  ASSERT_EQ(view.num_rows(), 2);
+  ASSERT_EQ(view.num_collumns(), 3);
+  ASSERT_EQ(view[1][0], 4);
+  ASSERT_EQ(view.get_gsl_matrix()->data, data);
+
+  view[1][2] = 60;
+  ASSERT_EQ(data[6], 60);
+
+  // Copies own their data
+  Matrix copy = view;
+  copy[0][0] = 10;
+  ASSERT_EQ(data[0], 1);
+  ASSERT_TRUE(copy != view);
+
+  // Moving keeps aliasing the same data
+  Matrix moved = std::move(view);
+  ASSERT_EQ(moved.get_gsl_matrix()->data, data);
+  ASSERT_EQ((moved * Matrix{{1}, {1}, {1}})[1][0], 69);
+
+  ASSERT_THROW(Matrix::view(data, 2, 5, 4), std::range_error);
+
+  // Assigning to a view gives it its own data instead of writing through
+  const Matrix zeros = {{0, 0, 0}, {0, 0, 0}};
+  moved = zeros;
+  ASSERT_NE(moved.get_gsl_matrix()->data, data);
+  ASSERT_EQ(moved[1][2], 0);
+  ASSERT_EQ(data[1], 2);
+}
+
+TEST(InteropTest, VectorView)
+{
+  double data[] = {1, -1, 2, -1, 3, -1};
+  Vector view = Vector::view(data, 3, 2);
+
+  ASSERT_EQ(view.size(), 3);
+  ASSERT_EQ(view[2], 3);
+  view[1] = 20;
+  ASSERT_EQ(data[2], 20);
+
+  Vector copy = view;
+  ASSERT_EQ(copy[1], 20);
+  copy[1] = 0;
+  ASSERT_EQ(data[2], 20);
+
+  // Assignment rebinds a view to its own data even when the sizes match,
+  // like it does for Matrix
+  view = copy;
+  ASSERT_NE(view.get_gsl_vector()->data, data);
+  ASSERT_EQ(view[1], 0);
+  ASSERT_EQ(data[2], 20);
+
+  Matrix matrix = {{1, 2}, {3, 4}};
+  auto row = matrix[1];
+  Vector row_view = Vector::view(row.data(), row.size());
+  row_view[0] = 30;
+  ASSERT_EQ(matrix[1][0], 30);
+}
+
+#ifdef GSL_WRAPPER_HAVE_EIGEN
+TEST(InteropTest, Eigen)
+{
+  double data[] = {1, 2, 3, -1, 4, 5, 6, -1};
+  Matrix view = Matrix::view(data, 2, 3, 4);
+
+  auto map = gsl_wrapper::as_eigen(view);
+  ASSERT_EQ(map.rows(), 2);
+  ASSERT_EQ(map.cols(), 3);
+  ASSERT_EQ(map(1, 2), 6);
+  map(0, 1) = 20;
+  ASSERT_EQ(view[0][1], 20);
+
+  const Matrix &constant = view;
+  Eigen::Vector3d ones = Eigen::Vector3d::Ones();
+  Eigen::Vector2d sums = gsl_wrapper::as_eigen(constant) * ones;
+  ASSERT_EQ(sums(0), 24);
+  ASSERT_EQ(sums(1), 15);
+
+  Matrix adopted = gsl_wrapper::from_eigen(map);
+  ASSERT_EQ(adopted.get_gsl_matrix()->data, data);
+  ASSERT_EQ(adopted.get_gsl_matrix()->tda, 4);
+
+  gsl_wrapper::EigenRowMajorMatrix row_major(2, 2);
+  row_major << 1, 2, 3, 4;
+  Matrix from_row_major = gsl_wrapper::from_eigen(row_major);
+  ASSERT_EQ(from_row_major[1][0], 3);
+
+  Eigen::MatrixXd collumn_major(2, 3);
+  collumn_major << 1, 2, 3, 4, 5, 6;
+  Matrix transposed = gsl_wrapper::from_eigen_transposed(collumn_major);
+  ASSERT_EQ(transposed.num_rows(), 3);
+  ASSERT_EQ(transposed[2][1], 6);
+
+  Vector vector = {1, 2, 3};
+  gsl_wrapper::as_eigen(vector) *= 2.0;
+  ASSERT_EQ(vector[2], 6);
+
+  auto row = gsl_wrapper::as_eigen(view[1]);
+  ASSERT_EQ(row.sum(), 15);
+  row(0) = 40;
+  ASSERT_EQ(data[4], 40);
+
+  // Rows of a const matrix are only readable
+  auto const_row = gsl_wrapper::as_eigen(constant[1]);
+  static_assert(std::is_same_v<decltype(const_row), gsl_wrapper::ConstEigenVectorMap>);
+  ASSERT_EQ(const_row.sum(), 51);
+
+  Eigen::VectorXd eigen_vector(3);
+  eigen_vector << 7, 8, 9;
+  Vector adopted_vector = gsl_wrapper::from_eigen(eigen_vector);
+  ASSERT_EQ(adopted_vector.get_gsl_vector()->data, eigen_vector.data());
+  ASSERT_EQ(adopted_vector[1], 8);
+}
+#endif
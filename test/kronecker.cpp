@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <array>
+
+#include <gsl_wrapper/kronecker.h>
+
+using gsl_wrapper::ConjugateGradient;
+using gsl_wrapper::KroneckerOperator;
+using gsl_wrapper::Matrix;
+using gsl_wrapper::Vector;
+
+namespace
+{
+  auto multiply(const Matrix &matrix, const Vector &x) -> Vector
+  {
+    Vector result(matrix.num_rows());
+    for (size_t i = 0; i < matrix.num_rows(); i++)
+    {
+      double sum = 0.0;
+      for (size_t j = 0; j < matrix.num_collumns(); j++)
+        sum += matrix[i][j] * x[j];
+      result[i] = sum;
+    }
+    return result;
+  }
+}
+
+TEST(KroneckerTest, MatchesDenseProduct)
+{
+  // Both orders of the two products get used
+  for (auto [p, q, r, s] : {std::array<size_t, 4>{3, 5, 4, 2}, std::array<size_t, 4>{7, 2, 3, 6}})
+  {
+    Matrix a(p, q);
+    Matrix b(r, s);
+    a.fill_uniform(1, -1.0, 1.0);
+    b.fill_uniform(2, -1.0, 1.0);
+    Vector x(q * s);
+    x.fill_uniform(3, -1.0, 1.0);
+
+    KroneckerOperator op(a, b);
+    ASSERT_EQ(op.num_rows(), p * r);
+    ASSERT_EQ(op.num_collumns(), q * s);
+
+    Vector lazy = op * x;
+    Vector dense = multiply(op.to_matrix(), x);
+    for (size_t i = 0; i < p * r; i++)
+    {
+      ASSERT_NEAR(std::as_const(lazy)[i], std::as_const(dense)[i], 1e-12);
+    }
+
+    Vector wrong(q * s + 1);
+    ASSERT_THROW(op * wrong, std::range_error);
+  }
+}
+
+TEST(KroneckerTest, StridedVectors)
+{
+  Matrix a{{2, 1}, {0, 3}};
+  Matrix b{{1, 4}, {2, 1}};
+  KroneckerOperator op(a, b);
+
+  double x_storage[8] = {1, -1, 2, -1, 3, -1, 4, -1};
+  double y_storage[8] = {};
+  const Vector x = Vector::view(x_storage, 4, 2);
+  Vector y = Vector::view(y_storage, 4, 2);
+  op.apply(x, y);
+
+  Vector expected = multiply(op.to_matrix(), Vector{1, 2, 3, 4});
+  for (size_t i = 0; i < 4; i++)
+  {
+    ASSERT_DOUBLE_EQ(y_storage[2 * i], std::as_const(expected)[i]);
+    ASSERT_EQ(y_storage[2 * i + 1], 0.0);
+  }
+}
+
+TEST(KroneckerTest, ConjugateGradient)
+{
+  // Kronecker product of two symmetric positive definite matrices
+  Matrix a{{4, 1, 0}, {1, 3, 1}, {0, 1, 2}};
+  Matrix b{{2, -1}, {-1, 2}};
+  KroneckerOperator op(a, b);
+
+  Vector solution{1, -2, 3, 0.5, -1, 2};
+  Vector rhs = op * solution;
+  Vector x(6);
+
+  ConjugateGradient solver(6);
+  solver.solve(op.to_linear_operator(), rhs, x);
+  for (size_t i = 0; i < 6; i++)
+  {
+    ASSERT_NEAR(std::as_const(x)[i], std::as_const(solution)[i], 1e-8);
+  }
+
+  ASSERT_THROW(KroneckerOperator(Matrix(2, 3), b).to_linear_operator(), std::range_error);
+}
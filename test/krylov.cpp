@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include <gsl_wrapper/krylov.h>
+
+using gsl_wrapper::BiCGSTAB;
+using gsl_wrapper::ConjugateGradient;
+using gsl_wrapper::GMRES;
+using gsl_wrapper::ILU0Preconditioner;
+using gsl_wrapper::JacobiPreconditioner;
+using gsl_wrapper::LinearOperator;
+using gsl_wrapper::Matrix;
+using gsl_wrapper::Vector;
+
+namespace
+{
+  // Tridiagonal test system, symmetric when skew is zero
+  auto tridiagonal(size_t size, double skew) -> Matrix
+  {
+    Matrix result(size);
+    for (size_t i = 0; i < size; i++)
+    {
+      result[i][i] = 4.0 + i * 0.01;
+      if (i + 1 < size)
+      {
+        result[i][i + 1] = -1.0 + skew;
+        result[i + 1][i] = -1.0 - skew;
+      }
+    }
+    return result;
+  }
+
+  auto residual_norm(const Matrix &matrix, const Vector &b, const Vector &x) -> double
+  {
+    Vector r = b;
+    gsl_blas_dgemv(CblasNoTrans, -1.0, matrix.get_gsl_matrix(), x.get_gsl_vector(), 1.0, r.get_gsl_vector());
+    return gsl_blas_dnrm2(r.get_gsl_vector());
+  }
+
+  auto right_hand_side(size_t size) -> Vector
+  {
+    Vector b(size);
+    for (size_t i = 0; i < size; i++)
+    {
+      b[i] = 1.0 + (i % 7);
+    }
+    return b;
+  }
+}
+
+TEST(KrylovTest, ConjugateGradient)
+{
+  Matrix matrix = tridiagonal(60, 0.0);
+  Vector b = right_hand_side(60);
+
+  ConjugateGradient solver(60);
+  for (int attempt = 0; attempt < 2; attempt++)
+  {
+    Vector x(60);
+    auto result = solver.solve(LinearOperator(matrix), b, x);
+    ASSERT_TRUE(result.converged);
+    ASSERT_LT(residual_norm(matrix, b, x), 1e-8);
+  }
+
+  Vector x(60);
+  auto result = solver.solve(LinearOperator(matrix), b, x, JacobiPreconditioner(matrix));
+  ASSERT_TRUE(result.converged);
+  ASSERT_LT(residual_norm(matrix, b, x), 1e-8);
+}
+
+TEST(KrylovTest, BiCGSTAB)
+{
+  Matrix matrix = tridiagonal(50, 0.4);
+  Vector b = right_hand_side(50);
+
+  BiCGSTAB solver(50);
+  Vector x(50);
+  auto result = solver.solve(LinearOperator(matrix), b, x);
+  ASSERT_TRUE(result.converged);
+  ASSERT_LT(residual_norm(matrix, b, x), 1e-8);
+
+  Vector preconditioned(50);
+  auto fast = solver.solve(LinearOperator(matrix), b, preconditioned, ILU0Preconditioner(matrix));
+  ASSERT_TRUE(fast.converged);
+  ASSERT_LE(fast.iterations, 2);
+  ASSERT_LT(residual_norm(matrix, b, preconditioned), 1e-8);
+}
+
+TEST(KrylovTest, RestartedGMRES)
+{
+  Matrix matrix = tridiagonal(40, 0.7);
+  Vector b = right_hand_side(40);
+
+  GMRES solver(40, 5);
+  Vector x(40);
+  auto result = solver.solve(LinearOperator(matrix), b, x, JacobiPreconditioner(matrix));
+  ASSERT_TRUE(result.converged);
+  ASSERT_LT(residual_norm(matrix, b, x), 1e-8);
+}
+
+TEST(KrylovTest, SparseAndCallableOperators)
+{
+  Matrix dense = tridiagonal(30, 0.2);
+  gsl_spmatrix *sparse = gsl_spmatrix_alloc(30, 30);
+  for (size_t i = 0; i < 30; i++)
+  {
+    for (size_t j = 0; j < 30; j++)
+    {
+      if (dense[i][j] != 0.0)
+        gsl_spmatrix_set(sparse, i, j, dense[i][j]);
+    }
+  }
+  Vector b = right_hand_side(30);
+
+  GMRES solver(30);
+  Vector x(30);
+  ASSERT_TRUE(solver.solve(LinearOperator(sparse), b, x, ILU0Preconditioner(sparse)).converged);
+  ASSERT_LT(residual_norm(dense, b, x), 1e-8);
+
+  size_t calls = 0;
+  LinearOperator callable(30, [&](const Vector &in, Vector &out)
+                          {
+                            ++calls;
+                            gsl_blas_dgemv(CblasNoTrans, 1.0, dense.get_gsl_matrix(), in.get_gsl_vector(), 0.0, out.get_gsl_vector()); });
+  Vector y(30);
+  ASSERT_TRUE(solver.solve(callable, b, y).converged);
+  ASSERT_GT(calls, 0);
+
+  gsl_spmatrix_free(sparse);
+}
+
+TEST(KrylovTest, CallbackStopsEarly)
+{
+  Matrix matrix = tridiagonal(60, 0.0);
+  Vector b = right_hand_side(60);
+
+  ConjugateGradient solver(60);
+  solver.set_callback([](size_t iteration, double)
+                      { return iteration < 3; });
+
+  Vector x(60);
+  auto result = solver.solve(LinearOperator(matrix), b, x);
+  ASSERT_FALSE(result.converged);
+  ASSERT_EQ(result.iterations, 3);
+
+  // The converging iteration is reported as well
+  size_t last = 0;
+  solver.set_callback([&last](size_t iteration, double)
+                      {
+                        last = iteration;
+                        return true; });
+  Vector y(60);
+  result = solver.solve(LinearOperator(matrix), b, y);
+  ASSERT_TRUE(result.converged);
+  ASSERT_EQ(last, result.iterations);
+
+  EXPECT_THROW({ solver.solve(LinearOperator(matrix), Vector(10), x); }, std::range_error);
+}
+
+TEST(KrylovTest, BreakdownAndErrors)
+{
+  // Rotation with r_hat orthogonal to A r, BiCGSTAB breaks down at once
+  Matrix rotation{{0.0, 1.0}, {-1.0, 0.0}};
+  Vector b{1.0, 0.0};
+  Vector x(2);
+  BiCGSTAB solver(2);
+  auto result = solver.solve(LinearOperator(rotation), b, x);
+  ASSERT_FALSE(result.converged);
+  ASSERT_EQ(result.iterations, 0);
+  ASSERT_EQ(x[0], 0.0);
+  ASSERT_EQ(x[1], 0.0);
+
+  Matrix rectangular(3, 4);
+  EXPECT_THROW({ JacobiPreconditioner{rectangular}; }, std::range_error);
+  EXPECT_THROW({ ILU0Preconditioner{rectangular}; }, std::range_error);
+  EXPECT_THROW({ LinearOperator{rectangular}; }, std::range_error);
+}
@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <stdexcept>
+
+#include <gsl/gsl_blas.h>
+
+#include <gsl_wrapper/matrix-batch.h>
+
+using gsl_wrapper::BatchLayout;
+using gsl_wrapper::Matrix;
+using gsl_wrapper::MatrixBatch;
+
+namespace
+{
+  // Deterministic, diagonally dominant when square so the solves are well conditioned
+  auto make_batch(size_t count, size_t rows, size_t collumns, BatchLayout layout, double seed) -> MatrixBatch
+  {
+    MatrixBatch result(count, rows, collumns, layout);
+    for (size_t k = 0; k < count; k++)
+    {
+      for (size_t i = 0; i < rows; i++)
+      {
+        for (size_t j = 0; j < collumns; j++)
+        {
+          result(k, i, j) = std::sin(seed + 0.37 * k + 1.3 * i + 0.7 * j) + (i == j ? rows : 0.0);
+        }
+      }
+    }
+    return result;
+  }
+
+  auto max_difference(const Matrix &a, const Matrix &b) -> double
+  {
+    double result = 0.0;
+    for (size_t i = 0; i < a.num_rows(); i++)
+    {
+      for (size_t j = 0; j < a.num_collumns(); j++)
+      {
+        result = std::fmax(result, std::fabs(a[i][j] - b[i][j]));
+      }
+    }
+    return result;
+  }
+}
+
+TEST(MatrixBatchTest, Layouts)
+{
+  Matrix matrix = {{1, 2, 3}, {4, 5, 6}};
+
+  for (auto layout : {BatchLayout::Strided, BatchLayout::Interleaved})
+  {
+    MatrixBatch batch(3, 2, 3, layout);
+    batch.set(1, matrix);
+
+    ASSERT_EQ(batch.get(1), matrix);
+    ASSERT_EQ(batch(1, 1, 2), 6.0);
+    ASSERT_EQ(batch(0, 1, 2), 0.0);
+    ASSERT_THROW(batch(3, 0, 0), std::range_error);
+    ASSERT_THROW(batch.set(0, Matrix(3, 2)), std::range_error);
+  }
+
+  MatrixBatch interleaved(3, 2, 3, BatchLayout::Interleaved);
+  interleaved.set(1, matrix);
+  ASSERT_EQ(interleaved.data()[(1 * 3 + 2) * 3 + 1], 6.0);
+
+  MatrixBatch strided = interleaved.with_layout(BatchLayout::Strided);
+  ASSERT_EQ(strided.data()[6 + 5], 6.0);
+  ASSERT_EQ(strided.get(1), matrix);
+}
+
+TEST(MatrixBatchTest, View)
+{
+  MatrixBatch batch = make_batch(4, 3, 3, BatchLayout::Strided, 0.5);
+  gsl_matrix_view view = batch.view(2);
+  ASSERT_EQ(gsl_matrix_get(&view.matrix, 1, 2), batch(2, 1, 2));
+
+  gsl_matrix_set(&view.matrix, 0, 0, 42.0);
+  ASSERT_EQ(batch(2, 0, 0), 42.0);
+
+  MatrixBatch interleaved(4, 3, 3);
+  ASSERT_THROW(interleaved.view(0), std::runtime_error);
+}
+
+TEST(MatrixBatchTest, Gemm)
+{
+  for (auto layout : {BatchLayout::Strided, BatchLayout::Interleaved})
+  {
+    // Large enough for the work to be split between threads
+    MatrixBatch a = make_batch(2000, 5, 4, layout, 0.1);
+    MatrixBatch b = make_batch(2000, 4, 3, layout, 0.2);
+    MatrixBatch c = make_batch(2000, 5, 3, layout, 0.3);
+    MatrixBatch original = c;
+
+    gsl_wrapper::gemm(2.0, a, b, 0.5, c);
+    MatrixBatch product = a * b;
+
+    for (size_t k : {size_t{0}, size_t{999}, size_t{1999}})
+    {
+      Matrix expected = a.get(k) * b.get(k);
+      ASSERT_LT(max_difference(product.get(k), expected), 1e-12);
+      ASSERT_LT(max_difference(c.get(k), expected * 2.0 + original.get(k) * 0.5), 1e-12);
+    }
+  }
+
+  MatrixBatch a(2, 3, 3);
+  ASSERT_THROW(gsl_wrapper::gemm(1.0, a, a, 0.0, a), std::runtime_error);
+  ASSERT_THROW(a * MatrixBatch(2, 2, 3), std::range_error);
+  ASSERT_THROW(a * MatrixBatch(2, 3, 3, BatchLayout::Strided), std::range_error);
+}
+
+TEST(MatrixBatchTest, LUSolve)
+{
+  for (auto layout : {BatchLayout::Strided, BatchLayout::Interleaved})
+  {
+    MatrixBatch a = make_batch(500, 6, 6, layout, 0.4);
+    MatrixBatch b = make_batch(500, 6, 2, layout, 0.8);
+    MatrixBatch lu = a;
+    MatrixBatch x = b;
+
+    gsl_wrapper::lu_solve(lu, x);
+
+    MatrixBatch residual = a * x;
+    residual -= b;
+    for (size_t k = 0; k < 500; k++)
+    {
+      for (size_t i = 0; i < 6; i++)
+      {
+        ASSERT_NEAR(residual(k, i, 0), 0.0, 1e-12);
+        ASSERT_NEAR(residual(k, i, 1), 0.0, 1e-12);
+      }
+    }
+  }
+}
+
+TEST(MatrixBatchTest, LUSolveWithSingularMatrix)
+{
+  // The regular systems around the singular one are solved before the throw
+  for (auto layout : {BatchLayout::Strided, BatchLayout::Interleaved})
+  {
+    MatrixBatch a(3, 2, 2, layout);
+    a.set(0, Matrix{{2, 0}, {0, 4}});
+    a.set(1, Matrix{{1, 2}, {2, 4}});
+    a.set(2, Matrix{{0, 1}, {1, 0}});
+    MatrixBatch b(3, 2, 1, layout);
+    for (size_t k = 0; k < 3; k++)
+    {
+      b.set(k, Matrix{{2}, {8}});
+    }
+
+    ASSERT_THROW(gsl_wrapper::lu_solve(a, b), std::runtime_error);
+    ASSERT_NEAR(b(0, 0, 0), 1.0, 1e-15);
+    ASSERT_NEAR(b(0, 1, 0), 2.0, 1e-15);
+    ASSERT_NEAR(b(2, 0, 0), 8.0, 1e-15);
+    ASSERT_NEAR(b(2, 1, 0), 2.0, 1e-15);
+  }
+}
+
+TEST(MatrixBatchTest, Inverse)
+{
+  for (auto layout : {BatchLayout::Strided, BatchLayout::Interleaved})
+  {
+    MatrixBatch a = make_batch(10, 4, 4, layout, 1.5);
+    MatrixBatch identity = a * gsl_wrapper::inverse(a);
+
+    for (size_t k = 0; k < 10; k++)
+    {
+      ASSERT_LT(max_difference(identity.get(k), Matrix{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}), 1e-12);
+    }
+
+    MatrixBatch singular(3, 2, 2, layout);
+    singular.set(0, Matrix{{1, 0}, {0, 1}});
+    singular.set(1, Matrix{{1, 2}, {2, 4}});
+    singular.set(2, Matrix{{1, 0}, {0, 1}});
+    ASSERT_THROW(gsl_wrapper::inverse(singular), std::runtime_error);
+  }
+}
+
+TEST(MatrixBatchTest, Elementwise)
+{
+  MatrixBatch a = make_batch(3, 2, 2, BatchLayout::Interleaved, 0.0);
+  MatrixBatch b = make_batch(3, 2, 2, BatchLayout::Interleaved, 1.0);
+  MatrixBatch sum = a;
+  MatrixBatch product = a;
+
+  sum += b;
+  product.multiply_elements(b);
+  a *= 3.0;
+
+  ASSERT_DOUBLE_EQ(sum(2, 1, 0), a(2, 1, 0) / 3.0 + b(2, 1, 0));
+  ASSERT_DOUBLE_EQ(product(1, 0, 1), a(1, 0, 1) / 3.0 * b(1, 0, 1));
+
+  MatrixBatch strided(3, 2, 2, BatchLayout::Strided);
+  ASSERT_THROW(sum += strided, std::range_error);
+}
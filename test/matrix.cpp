@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <type_traits>
+#include <utility>
+
 #include <gsl_wrapper/matrix.h>
 
 using gsl_wrapper::Matrix;
@@ -164,4 +167,220 @@ TEST(MatrixTest, MatrixAddition)
   Matrix result = first + to_add;
 
   ASSERT_TRUE(result == expected);
-}
\ No newline at end of file
+}
+
+TEST(MatrixTest, HugePageAllocation)
+{
+  using gsl_wrapper::Allocation;
+
+  Matrix test_subject(300, 200, Allocation::HugePages);
+  gsl_matrix *view = test_subject.get_gsl_matrix();
+
+  ASSERT_EQ(view->size1, 300);
+  ASSERT_EQ(view->size2, 200);
+  ASSERT_EQ(view->tda, 200);
+  ASSERT_EQ(view->owner, 0);
+#if defined(__unix__) || defined(__APPLE__)
+  ASSERT_EQ(reinterpret_cast<std::uintptr_t>(view->data) % gsl_wrapper::bits::huge_page_size, 0);
+#endif
+  ASSERT_TRUE(test_subject == Matrix(300, 200));
+
+  test_subject[299][199] = 5;
+  Matrix copy = test_subject;
+  ASSERT_EQ(copy[299][199], 5);
+
+  Matrix moved = std::move(test_subject);
+  ASSERT_EQ(test_subject.get_gsl_matrix(), nullptr);
+  ASSERT_EQ(moved[299][199], 5);
+  ASSERT_EQ(moved.get_gsl_matrix()->data, view->data);
+
+  Matrix result = moved * Matrix(200, 3);
+  ASSERT_EQ(result.get_dimensions(), std::make_pair(size_t{300}, size_t{3}));
+}
+
+TEST(MatrixTest, CopyOnWrite)
+{
+  Matrix original{{1, 2}, {3, 4}};
+  original.enable_copy_on_write();
+  const double *data = std::as_const(original).get_gsl_matrix()->data;
+
+  Matrix copy = original;
+  ASSERT_TRUE(copy.is_copy_on_write());
+  ASSERT_TRUE(original.shares_storage());
+  ASSERT_EQ(std::as_const(copy).get_gsl_matrix()->data, data);
+  ASSERT_TRUE(copy == original);
+
+  copy[0][0] = 10;
+  ASSERT_FALSE(copy.shares_storage());
+  ASSERT_FALSE(original.shares_storage());
+  ASSERT_EQ(original[0][0], 1);
+  ASSERT_EQ(copy[0][0], 10);
+  ASSERT_EQ(std::as_const(original).get_gsl_matrix()->data, data);
+
+  Matrix assigned(5, 5);
+  assigned = original;
+  ASSERT_TRUE(assigned.shares_storage());
+  Matrix sum = assigned + original;
+  ASSERT_EQ(sum[1][1], 8);
+  ASSERT_TRUE(assigned.shares_storage());
+
+  Matrix moved = std::move(assigned);
+  ASSERT_TRUE(moved.shares_storage());
+  gsl_matrix_set(moved.get_gsl_matrix(), 1, 1, -1);
+  ASSERT_EQ(original[1][1], 4);
+  ASSERT_EQ(moved[1][1], -1);
+
+  // Assigning a plain matrix keeps the target copy on write
+  const Matrix plain{{5, 6}, {7, 8}};
+  moved = plain;
+  ASSERT_TRUE(moved.is_copy_on_write());
+  Matrix shared = moved;
+  ASSERT_TRUE(shared.shares_storage());
+
+  // Rows of a const matrix stay read-only when copied, so they cannot write
+  // into storage shared with other matrices
+  const Matrix &constant = shared;
+  auto row = constant[1];
+  static_assert(!std::is_convertible_v<decltype(row), gsl_wrapper::bits::MatrixRow>);
+  static_assert(!std::is_assignable_v<decltype(row[0]), double>);
+  gsl_wrapper::Vector values = row;
+  ASSERT_EQ(values[1], 8);
+  ASSERT_EQ(row.data(), std::as_const(moved).get_gsl_matrix()->data + 2);
+}
+
+TEST(MatrixTest, BlockedGemm)
+{
+  // Sizes straddling the register, cache and thread blocking
+  const std::pair<size_t, size_t> shapes[] = {{1, 1}, {5, 3}, {97, 261}, {300, 130}};
+  for (auto [rows, inner] : shapes)
+  {
+    const size_t collumns = rows + 7;
+    Matrix a(rows, inner);
+    Matrix b(inner, collumns);
+    Matrix c(rows, collumns);
+    for (size_t i = 0; i < rows; i++)
+      for (size_t j = 0; j < inner; j++)
+        a[i][j] = std::sin(0.3 * i + 0.7 * j);
+    for (size_t i = 0; i < inner; i++)
+      for (size_t j = 0; j < collumns; j++)
+        b[i][j] = std::cos(0.5 * i - 0.2 * j);
+    for (size_t i = 0; i < rows; i++)
+      for (size_t j = 0; j < collumns; j++)
+        c[i][j] = 1.0 + i - j;
+
+    Matrix product = a * b;
+    Matrix updated = c;
+    gsl_wrapper::bits::blocked_gemm(CblasNoTrans, CblasNoTrans, 2.0, a.get_gsl_matrix(), b.get_gsl_matrix(), -1.0, updated.get_gsl_matrix());
+
+    for (size_t i = 0; i < rows; i++)
+    {
+      for (size_t j = 0; j < collumns; j++)
+      {
+        double expected = 0.0;
+        for (size_t p = 0; p < inner; p++)
+          expected += a[i][p] * b[p][j];
+        ASSERT_NEAR(product[i][j], expected, 1e-12);
+        ASSERT_NEAR(updated[i][j], 2.0 * expected - c[i][j], 1e-12);
+      }
+    }
+  }
+}
+
+TEST(MatrixTest, BlockedGemmTransposed)
+{
+  Matrix a(40, 30);
+  Matrix b(50, 40);
+  for (size_t i = 0; i < 40; i++)
+    for (size_t j = 0; j < 30; j++)
+      a[i][j] = i * 0.1 - j * 0.05;
+  for (size_t i = 0; i < 50; i++)
+    for (size_t j = 0; j < 40; j++)
+      b[i][j] = std::sin(i + 2.0 * j);
+
+  // (A^T B^T) is 30 x 50
+  Matrix c(30, 50);
+  gsl_wrapper::bits::blocked_gemm(CblasTrans, CblasTrans, 1.0, a.get_gsl_matrix(), b.get_gsl_matrix(), 0.0, c.get_gsl_matrix());
+  for (size_t i = 0; i < 30; i++)
+  {
+    for (size_t j = 0; j < 50; j++)
+    {
+      double expected = 0.0;
+      for (size_t p = 0; p < 40; p++)
+        expected += a[p][i] * b[j][p];
+      ASSERT_NEAR(c[i][j], expected, 1e-12);
+    }
+  }
+
+  Matrix wrong(30, 49);
+  ASSERT_THROW(gsl_wrapper::bits::blocked_gemm(CblasTrans, CblasTrans, 1.0, a.get_gsl_matrix(), b.get_gsl_matrix(), 0.0, wrong.get_gsl_matrix()), std::range_error);
+}
+
+TEST(MatrixTest, RandomFill)
+{
+  Matrix matrix(300, 200);
+  gsl_wrapper::Vector vector(300 * 200);
+  matrix.fill_gaussian(42);
+  vector.fill_gaussian(42);
+
+  // Element (i, j) is number i * collumns + j of the sequence
+  for (size_t i = 0; i < 300; i++)
+  {
+    for (size_t j = 0; j < 200; j++)
+    {
+      ASSERT_EQ(std::as_const(matrix)[i][j], std::as_const(vector)[i * 200 + j]);
+    }
+  }
+
+  Matrix again(300, 200);
+  again.fill_gaussian(42);
+  ASSERT_TRUE(again == matrix);
+  again.fill_uniform(42);
+  ASSERT_FALSE(again == matrix);
+}
+
+TEST(MatrixTest, BlockAssembly)
+{
+  Matrix a{{1, 2}, {3, 4}};
+  Matrix b{{5}, {6}};
+  Matrix c{{7, 8, 9}};
+
+  Matrix assembled = Matrix::block({{a, b}, {c}});
+  Matrix expected{{1, 2, 5}, {3, 4, 6}, {7, 8, 9}};
+  ASSERT_TRUE(assembled == expected);
+
+  ASSERT_TRUE(gsl_wrapper::hstack({a, b}) == Matrix({{1, 2, 5}, {3, 4, 6}}));
+  ASSERT_TRUE(gsl_wrapper::vstack({a, Matrix{{0, 0}}}) == Matrix({{1, 2}, {3, 4}, {0, 0}}));
+
+  ASSERT_THROW(Matrix::block({{a, c}}), std::range_error);
+  ASSERT_THROW(Matrix::block({{a}, {c}}), std::range_error);
+
+  // Large enough to be copied by the thread pool
+  Matrix left(700, 300);
+  Matrix right(700, 500);
+  left.fill_uniform(1);
+  right.fill_uniform(2);
+  Matrix wide = gsl_wrapper::hstack({left, right});
+  for (size_t i = 0; i < 700; i++)
+  {
+    for (size_t j = 0; j < 800; j++)
+    {
+      ASSERT_EQ(std::as_const(wide)[i][j], j < 300 ? std::as_const(left)[i][j] : std::as_const(right)[i][j - 300]);
+    }
+  }
+}
+
+TEST(MatrixTest, KroneckerProduct)
+{
+  Matrix a{{1, 2}, {3, 4}};
+  Matrix b{{0, 5, 1}, {6, 7, 2}};
+
+  Matrix product = gsl_wrapper::kron(a, b);
+  ASSERT_EQ(product.num_rows(), 4);
+  ASSERT_EQ(product.num_collumns(), 6);
+
+  Matrix expected{{0, 5, 1, 0, 10, 2},
+                  {6, 7, 2, 12, 14, 4},
+                  {0, 15, 3, 0, 20, 4},
+                  {18, 21, 6, 24, 28, 8}};
+  ASSERT_TRUE(product == expected);
+}
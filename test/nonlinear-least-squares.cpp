@@ -0,0 +1,201 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gsl_wrapper/nonlinear-least-squares.h>
+
+using gsl_wrapper::fit_batch;
+using gsl_wrapper::FitResult;
+using gsl_wrapper::LeastSquaresModel;
+using gsl_wrapper::Matrix;
+using gsl_wrapper::NonlinearLeastSquares;
+using gsl_wrapper::Vector;
+
+namespace
+{
+  constexpr size_t num_samples = 40;
+
+  // Samples of amplitude exp(-rate t) + offset at t = 0.25 i
+  auto decay_samples(double amplitude, double rate, double offset) -> std::vector<double>
+  {
+    std::vector<double> samples(num_samples);
+    for (size_t i = 0; i < num_samples; i++)
+      samples[i] = amplitude * std::exp(-rate * 0.25 * double(i)) + offset;
+    return samples;
+  }
+
+  auto decay_model(std::vector<double> samples, bool with_jacobian) -> LeastSquaresModel
+  {
+    auto residual = [samples](const Vector &p, Vector &f)
+    {
+      for (size_t i = 0; i < num_samples; i++)
+        f[i] = p[0] * std::exp(-p[1] * 0.25 * double(i)) + p[2] - samples[i];
+    };
+    if (!with_jacobian)
+      return LeastSquaresModel(num_samples, 3, residual);
+
+    auto jacobian = [](const Vector &p, Matrix &J)
+    {
+      for (size_t i = 0; i < num_samples; i++)
+      {
+        const double t = 0.25 * double(i);
+        const double e = std::exp(-p[1] * t);
+        J[i][0] = e;
+        J[i][1] = -t * p[0] * e;
+        J[i][2] = 1.0;
+      }
+    };
+    return LeastSquaresModel(num_samples, 3, residual, jacobian);
+  }
+}
+
+TEST(NonlinearLeastSquaresTest, ExponentialFit)
+{
+  for (bool with_jacobian : {true, false})
+  {
+    NonlinearLeastSquares solver(num_samples, 3);
+    Vector parameters{1.0, 0.1, 0.0};
+    FitResult result = solver.fit(decay_model(decay_samples(5.0, 0.3, 1.0), with_jacobian), parameters);
+
+    ASSERT_TRUE(result.converged);
+    ASSERT_GT(result.iterations, 0);
+    ASSERT_LT(result.residual_norm, 1e-5);
+    ASSERT_NEAR(parameters[0], 5.0, 1e-5);
+    ASSERT_NEAR(parameters[1], 0.3, 1e-5);
+    ASSERT_NEAR(parameters[2], 1.0, 1e-5);
+  }
+}
+
+TEST(NonlinearLeastSquaresTest, SolverReuse)
+{
+  NonlinearLeastSquares solver(num_samples, 3);
+
+  Vector first{1.0, 0.1, 0.0};
+  solver.fit(decay_model(decay_samples(2.0, 0.5, -1.0), true), first);
+  Vector second{1.0, 0.1, 0.0};
+  solver.fit(decay_model(decay_samples(3.0, 0.2, 0.5), true), second);
+
+  // The second fit gives what a fresh solver gives
+  NonlinearLeastSquares fresh(num_samples, 3);
+  Vector expected{1.0, 0.1, 0.0};
+  fresh.fit(decay_model(decay_samples(3.0, 0.2, 0.5), true), expected);
+  for (size_t i = 0; i < 3; i++)
+  {
+    ASSERT_EQ(second[i], expected[i]);
+  }
+  ASSERT_NEAR(first[0], 2.0, 1e-5);
+}
+
+TEST(NonlinearLeastSquaresTest, Covariance)
+{
+  // Straight line, the covariance is the inverse of J^T J
+  LeastSquaresModel line(4, 2, [](const Vector &p, Vector &f)
+                         {
+                           for (size_t i = 0; i < 4; i++)
+                             f[i] = p[0] + p[1] * double(i) - (2.0 + 3.0 * double(i));
+                         },
+                         [](const Vector &, Matrix &J)
+                         {
+                           for (size_t i = 0; i < 4; i++)
+                           {
+                             J[i][0] = 1.0;
+                             J[i][1] = double(i);
+                           }
+                         });
+
+  NonlinearLeastSquares solver(4, 2);
+  ASSERT_THROW(solver.covariance(), std::runtime_error);
+
+  Vector parameters{0.0, 0.0};
+  solver.fit(line, parameters);
+  ASSERT_NEAR(parameters[0], 2.0, 1e-8);
+  ASSERT_NEAR(parameters[1], 3.0, 1e-8);
+
+  // J^T J = {{4, 6}, {6, 14}} with determinant 20
+  Matrix covariance = solver.covariance();
+  ASSERT_NEAR(covariance[0][0], 14.0 / 20.0, 1e-10);
+  ASSERT_NEAR(covariance[0][1], -6.0 / 20.0, 1e-10);
+  ASSERT_NEAR(covariance[1][1], 4.0 / 20.0, 1e-10);
+}
+
+TEST(NonlinearLeastSquaresTest, Errors)
+{
+  ASSERT_THROW(NonlinearLeastSquares(2, 3), std::range_error);
+  ASSERT_THROW(LeastSquaresModel(2, 3, [](const Vector &, Vector &) {}), std::range_error);
+
+  NonlinearLeastSquares solver(num_samples, 3);
+  Vector wrong{1.0, 0.1};
+  ASSERT_THROW(solver.fit(decay_model(decay_samples(5.0, 0.3, 1.0), true), wrong), std::range_error);
+
+  // Exceptions of the callbacks come out of fit, the solver stays usable
+  LeastSquaresModel failing(num_samples, 3, [](const Vector &, Vector &)
+                            { throw std::logic_error{"residuals failed"}; });
+  Vector parameters{1.0, 0.1, 0.0};
+  ASSERT_THROW(solver.fit(failing, parameters), std::logic_error);
+
+  FitResult result = solver.fit(decay_model(decay_samples(5.0, 0.3, 1.0), true), parameters);
+  ASSERT_TRUE(result.converged);
+  ASSERT_NEAR(parameters[1], 0.3, 1e-5);
+
+  // Fitting stops at the first failing evaluation and rethrows its exception
+  const std::vector<double> samples = decay_samples(5.0, 0.3, 1.0);
+  const LeastSquaresModel working = decay_model(samples, true);
+  size_t calls = 0;
+  LeastSquaresModel failing_later(num_samples, 3, [&](const Vector &p, Vector &f)
+                                  {
+                                    if (++calls >= 4)
+                                      throw std::logic_error{"evaluation " + std::to_string(calls)};
+                                    working.residual(p, f);
+                                  },
+                                  [&](const Vector &p, Matrix &J)
+                                  { working.jacobian(p, J); });
+  Vector start{1.0, 0.1, 0.0};
+  try
+  {
+    solver.fit(failing_later, start);
+    FAIL() << "fit did not rethrow";
+  }
+  catch (const std::logic_error &error)
+  {
+    ASSERT_STREQ(error.what(), "evaluation 4");
+  }
+  ASSERT_EQ(calls, 4);
+}
+
+TEST(NonlinearLeastSquaresTest, Batch)
+{
+  const size_t count = 64;
+  std::vector<LeastSquaresModel> models;
+  Matrix parameters(count, 3);
+  for (size_t i = 0; i < count; i++)
+  {
+    models.push_back(decay_model(decay_samples(1.0 + 0.1 * double(i), 0.3, 0.5), true));
+    parameters[i][0] = 1.0;
+    parameters[i][1] = 0.1;
+    parameters[i][2] = 0.0;
+  }
+
+  std::vector<FitResult> results = fit_batch(models, parameters);
+  ASSERT_EQ(results.size(), count);
+  for (size_t i = 0; i < count; i++)
+  {
+    ASSERT_TRUE(results[i].converged);
+    ASSERT_NEAR(parameters[i][0], 1.0 + 0.1 * double(i), 1e-5);
+    ASSERT_NEAR(parameters[i][1], 0.3, 1e-5);
+  }
+
+  // One model from several starting points
+  Matrix starts{{1.0, 0.1, 0.0}, {4.0, 0.5, 2.0}, {10.0, 0.2, -1.0}};
+  results = fit_batch(decay_model(decay_samples(5.0, 0.3, 1.0), true), starts);
+  for (size_t i = 0; i < 3; i++)
+  {
+    ASSERT_TRUE(results[i].converged);
+    ASSERT_NEAR(starts[i][0], 5.0, 1e-5);
+  }
+
+  models.pop_back();
+  ASSERT_THROW(fit_batch(models, parameters), std::range_error);
+}
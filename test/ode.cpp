@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include <gsl_wrapper/ode.h>
+
+using gsl_wrapper::integrate_batch;
+using gsl_wrapper::Matrix;
+using gsl_wrapper::OdeDriver;
+using gsl_wrapper::OdeSettings;
+using gsl_wrapper::OdeStepper;
+using gsl_wrapper::OdeSystem;
+using gsl_wrapper::Vector;
+
+namespace
+{
+  // y' = -rate y
+  auto decay(double rate) -> OdeSystem
+  {
+    return OdeSystem(1, [rate](double, const Vector &y, Vector &dydt)
+                     { dydt[0] = -rate * y[0]; });
+  }
+
+  // x'' = -x as a first order system
+  auto oscillator() -> OdeSystem
+  {
+    return OdeSystem(
+        2,
+        [](double, const Vector &y, Vector &dydt)
+        {
+          dydt[0] = y[1];
+          dydt[1] = -y[0];
+        },
+        [](double, const Vector &, Matrix &dfdy, Vector &dfdt)
+        {
+          dfdy[0][0] = 0.0;
+          dfdy[0][1] = 1.0;
+          dfdy[1][0] = -1.0;
+          dfdy[1][1] = 0.0;
+          dfdt[0] = 0.0;
+          dfdt[1] = 0.0;
+        });
+  }
+}
+
+TEST(OdeTest, ExponentialDecay)
+{
+  OdeDriver driver(1);
+  Vector y{2.0};
+  double t = 0.0;
+  driver.integrate(decay(1.5), t, 1.0, y);
+
+  ASSERT_DOUBLE_EQ(t, 1.0);
+  ASSERT_NEAR(y[0], 2.0 * std::exp(-1.5), 1e-7);
+}
+
+TEST(OdeTest, DriverReuse)
+{
+  OdeDriver driver(2);
+  const OdeSystem system = oscillator();
+
+  // The same driver gives the same answer for a repeated integration
+  Vector first{1.0, 0.0};
+  Vector second{1.0, 0.0};
+  double t = 0.0;
+  driver.integrate(system, t, M_PI / 2, first);
+  t = 0.0;
+  driver.integrate(system, t, M_PI / 2, second);
+
+  ASSERT_NEAR(first[0], 0.0, 1e-7);
+  ASSERT_NEAR(first[1], -1.0, 1e-7);
+  ASSERT_EQ(first[0], second[0]);
+  ASSERT_EQ(first[1], second[1]);
+
+  // Integrating backwards returns to the start
+  driver.integrate(system, t, 0.0, second);
+  ASSERT_NEAR(second[0], 1.0, 1e-7);
+  ASSERT_NEAR(second[1], 0.0, 1e-7);
+}
+
+TEST(OdeTest, Trajectory)
+{
+  OdeDriver driver(2);
+  Vector y{1.0, 0.0};
+  Vector times{0.5, 1.0, 1.5};
+
+  Matrix states = driver.trajectory(oscillator(), 0.0, times, y);
+  ASSERT_EQ(states.num_rows(), 3);
+  ASSERT_EQ(states.num_collumns(), 2);
+  for (size_t i = 0; i < 3; i++)
+  {
+    ASSERT_NEAR(states[i][0], std::cos(times[i]), 1e-7);
+    ASSERT_NEAR(states[i][1], -std::sin(times[i]), 1e-7);
+  }
+  ASSERT_EQ(y[0], states[2][0]);
+}
+
+TEST(OdeTest, ImplicitStepperWithJacobian)
+{
+  OdeSettings settings;
+  settings.stepper = OdeStepper::BackwardDifferentiation;
+  OdeDriver driver(2, settings);
+
+  Vector y{1.0, 0.0};
+  double t = 0.0;
+  driver.integrate(oscillator(), t, 1.0, y);
+  ASSERT_NEAR(y[0], std::cos(1.0), 1e-6);
+
+  // Implicit steppers need the Jacobian
+  OdeDriver scalar(1, settings);
+  Vector z{1.0};
+  ASSERT_THROW(scalar.integrate(decay(1.0), t, 2.0, z), std::runtime_error);
+}
+
+TEST(OdeTest, Errors)
+{
+  OdeDriver driver(2);
+  Vector y{1.0};
+  double t = 0.0;
+  ASSERT_THROW(driver.integrate(oscillator(), t, 1.0, y), std::range_error);
+  ASSERT_THROW(OdeDriver(0), std::range_error);
+
+  // Exceptions of the callbacks come out of the driver, which stays usable
+  OdeSystem failing(2, [](double t, const Vector &, Vector &)
+                    {
+                      if (t > 0.5)
+                        throw std::logic_error{"right hand side failed"};
+                    });
+  Vector state{1.0, 0.0};
+  ASSERT_THROW(driver.integrate(failing, t, 1.0, state), std::logic_error);
+
+  state = Vector{1.0, 0.0};
+  t = 0.0;
+  driver.integrate(oscillator(), t, 1.0, state);
+  ASSERT_NEAR(state[0], std::cos(1.0), 1e-7);
+}
+
+TEST(OdeTest, Batch)
+{
+  const size_t count = 500;
+  Matrix states(count, 2);
+  for (size_t i = 0; i < count; i++)
+  {
+    states[i][0] = std::cos(0.01 * i);
+    states[i][1] = -std::sin(0.01 * i);
+  }
+
+  // Every row is the oscillator started at phase 0.01 i
+  integrate_batch(oscillator(), 0.0, 1.0, states);
+  for (size_t i = 0; i < count; i++)
+  {
+    ASSERT_NEAR(states[i][0], std::cos(0.01 * i + 1.0), 1e-7);
+    ASSERT_NEAR(states[i][1], -std::sin(0.01 * i + 1.0), 1e-7);
+  }
+
+  std::vector<OdeSystem> systems;
+  Matrix decays(count, 1);
+  for (size_t i = 0; i < count; i++)
+  {
+    systems.push_back(decay(0.01 * i));
+    decays[i][0] = 1.0;
+  }
+  integrate_batch(systems, 0.0, 2.0, decays);
+  for (size_t i = 0; i < count; i++)
+  {
+    ASSERT_NEAR(decays[i][0], std::exp(-0.02 * i), 1e-7);
+  }
+
+  systems.pop_back();
+  ASSERT_THROW(integrate_batch(systems, 0.0, 1.0, decays), std::range_error);
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <stdexcept>
+
+#include <gsl_wrapper/spline.h>
+
+using gsl_wrapper::Matrix;
+using gsl_wrapper::Spline;
+using gsl_wrapper::SplineCurves;
+using gsl_wrapper::SplineType;
+using gsl_wrapper::Vector;
+
+namespace
+{
+  auto grid(size_t size, double step) -> Vector
+  {
+    Vector result(size);
+    for (size_t i = 0; i < size; i++)
+      result[i] = step * double(i);
+    return result;
+  }
+}
+
+TEST(SplineTest, LinearData)
+{
+  // Every spline type reproduces a straight line
+  Vector x = grid(11, 1.0);
+  Vector y(11);
+  for (size_t i = 0; i < 11; i++)
+    y[i] = 2.0 * x[i] + 1.0;
+
+  for (SplineType type : {SplineType::Linear, SplineType::Cubic, SplineType::Akima, SplineType::Steffen})
+  {
+    Spline spline(x, y, type);
+    ASSERT_EQ(spline.size(), 11);
+    ASSERT_NEAR(spline(2.5), 6.0, 1e-12);
+    ASSERT_NEAR(spline(10.0), 21.0, 1e-12);
+    ASSERT_NEAR(spline.derivative(7.25), 2.0, 1e-12);
+    ASSERT_NEAR(spline.second_derivative(3.5), 0.0, 1e-10);
+    ASSERT_NEAR(spline.integral(0.0, 10.0), 110.0, 1e-10);
+  }
+}
+
+TEST(SplineTest, BatchMatchesPointwise)
+{
+  Vector x = grid(50, 0.1);
+  Vector y(50);
+  for (size_t i = 0; i < 50; i++)
+    y[i] = std::sin(x[i]);
+  Spline spline(x, y);
+
+  // Sorted queries hitting the grid points too, enough for several threads
+  const size_t count = 40000;
+  Vector sorted(count);
+  for (size_t i = 0; i < count; i++)
+    sorted[i] = 4.9 * double(i) / double(count - 1);
+
+  Vector values = spline.evaluate(sorted);
+  Vector slopes = spline.derivative(sorted);
+  for (size_t i = 0; i < count; i += 7)
+  {
+    ASSERT_EQ(values[i], spline(sorted[i]));
+    ASSERT_EQ(slopes[i], spline.derivative(sorted[i]));
+  }
+
+  Vector unsorted(1000);
+  unsorted.fill_uniform(9, 0.0, 4.9);
+  Vector result(1000);
+  spline.evaluate(unsorted, result);
+  for (size_t i = 0; i < 1000; i++)
+  {
+    ASSERT_EQ(result[i], spline(unsorted[i]));
+  }
+}
+
+TEST(SplineTest, StridedQueries)
+{
+  Spline spline(grid(5, 1.0), Vector{0.0, 1.0, 4.0, 9.0, 16.0}, SplineType::Linear);
+
+  double storage[6] = {0.5, -1.0, 3.5, -1.0, 1.0, -1.0};
+  const Vector queries = Vector::view(storage, 3, 2);
+  Vector values = spline.evaluate(queries);
+  ASSERT_DOUBLE_EQ(values[0], 0.5);
+  ASSERT_DOUBLE_EQ(values[1], 12.5);
+  ASSERT_DOUBLE_EQ(values[2], 1.0);
+}
+
+TEST(SplineTest, Errors)
+{
+  Vector x = grid(4, 1.0);
+  Vector y{1.0, 2.0, 0.0, 1.0};
+  Spline spline(x, y);
+
+  ASSERT_THROW(spline(3.5), std::range_error);
+  ASSERT_THROW(spline.evaluate(Vector{0.0, 4.0}), std::range_error);
+  ASSERT_THROW(spline.evaluate(Vector{0.0, NAN}), std::range_error);
+  ASSERT_THROW(spline.integral(2.0, 1.0), std::range_error);
+
+  ASSERT_THROW(Spline(x, Vector{1.0, 2.0}), std::range_error);
+  ASSERT_THROW(Spline(Vector{0.0, 2.0, 1.0}, Vector{1.0, 2.0, 3.0}), std::runtime_error);
+  ASSERT_THROW(Spline(Vector{0.0, 1.0}, Vector{1.0, 2.0}, SplineType::Akima), std::range_error);
+}
+
+TEST(SplineTest, CurvesOnOneGrid)
+{
+  Vector x = grid(20, 0.5);
+  Matrix y(3, 20);
+  y.fill_uniform(4);
+
+  SplineCurves curves(x, y);
+  ASSERT_EQ(curves.num_curves(), 3);
+  ASSERT_EQ(curves.size(), 20);
+
+  Vector queries(500);
+  queries.fill_uniform(6, 0.0, 9.5);
+  Matrix values = curves.evaluate(queries);
+  ASSERT_EQ(values.num_rows(), 3);
+  ASSERT_EQ(values.num_collumns(), 500);
+
+  for (size_t curve = 0; curve < 3; curve++)
+  {
+    Vector samples(20);
+    for (size_t i = 0; i < 20; i++)
+      samples[i] = y[curve][i];
+    Spline single(x, samples);
+
+    Vector expected = single.evaluate(queries);
+    for (size_t j = 0; j < 500; j++)
+    {
+      ASSERT_EQ(values[curve][j], expected[j]);
+      ASSERT_EQ(values[curve][j], curves(curve, queries[j]));
+    }
+  }
+
+  ASSERT_THROW(curves(3, 1.0), std::range_error);
+  ASSERT_THROW(SplineCurves(grid(19, 0.5), y), std::range_error);
+}
+
+TEST(SplineTest, SmallSplineAfterLargeOne)
+{
+  // Splines share the accelerator of the thread, the interval a large grid
+  // leaves in it lies past the end of a small one
+  Vector large_x = grid(50, 1.0);
+  Spline large(large_x, large_x, SplineType::Linear);
+  ASSERT_NEAR(large(48.5), 48.5, 1e-12);
+
+  Vector small_x = grid(4, 1.0);
+  Vector small_y(4);
+  for (size_t i = 0; i < 4; i++)
+  {
+    small_y[i] = 3.0 * small_x[i];
+  }
+  Spline small(small_x, small_y, SplineType::Linear);
+  ASSERT_NEAR(small(2.5), 7.5, 1e-12);
+  ASSERT_NEAR(large(48.5), 48.5, 1e-12);
+  ASSERT_NEAR(small.derivative(0.5), 3.0, 1e-12);
+  ASSERT_NEAR(large(48.5), 48.5, 1e-12);
+  ASSERT_NEAR(small.integral(0.5, 2.5), 9.0, 1e-12);
+
+  Matrix curves_y(2, 4);
+  curves_y[0][3] = 1.0;
+  curves_y[1][0] = 1.0;
+  SplineCurves curves(small_x, curves_y, SplineType::Linear);
+  ASSERT_NEAR(large(48.5), 48.5, 1e-12);
+  ASSERT_NEAR(curves(0, 2.5), 0.5, 1e-12);
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <stdexcept>
+
+#include <gsl_wrapper/svd.h>
+
+using gsl_wrapper::Matrix;
+using gsl_wrapper::SVD;
+
+namespace
+{
+  // Largest |(U S V^T - A)_ij|
+  auto reconstruction_error(const Matrix &matrix, const SVD &svd) -> double
+  {
+    const auto &u = svd.u();
+    const auto &s = svd.singular_values();
+    const auto &v = svd.v();
+
+    double result = 0.0;
+    for (size_t i = 0; i < matrix.num_rows(); i++)
+    {
+      for (size_t j = 0; j < matrix.num_collumns(); j++)
+      {
+        double sum = 0.0;
+        for (size_t k = 0; k < s.size(); k++)
+        {
+          sum += u[i][k] * s[k] * v[j][k];
+        }
+        result = std::fmax(result, std::fabs(sum - matrix[i][j]));
+      }
+    }
+    return result;
+  }
+
+  // Largest |(Q^T Q - I)_ij|
+  auto orthogonality_error(const Matrix &q) -> double
+  {
+    double result = 0.0;
+    for (size_t i = 0; i < q.num_collumns(); i++)
+    {
+      for (size_t j = 0; j < q.num_collumns(); j++)
+      {
+        double sum = 0.0;
+        for (size_t k = 0; k < q.num_rows(); k++)
+        {
+          sum += q[k][i] * q[k][j];
+        }
+        result = std::fmax(result, std::fabs(sum - (i == j ? 1.0 : 0.0)));
+      }
+    }
+    return result;
+  }
+}
+
+TEST(SVDTest, TallMatrix)
+{
+  Matrix matrix = {{1, 2, 3}, {4, 5, 6}, {7, 8, 10}, {1, 0, 1}};
+
+  for (auto method : {SVD::Method::GolubReinsch, SVD::Method::Modified, SVD::Method::Jacobi})
+  {
+    SVD svd(matrix, method);
+
+    ASSERT_EQ(svd.u().num_rows(), 4);
+    ASSERT_EQ(svd.u().num_collumns(), 3);
+    ASSERT_EQ(svd.v().num_rows(), 3);
+    ASSERT_EQ(svd.v().num_collumns(), 3);
+    ASSERT_EQ(svd.singular_values().size(), 3);
+    EXPECT_GE(svd.singular_values()[0], svd.singular_values()[1]);
+    EXPECT_GE(svd.singular_values()[1], svd.singular_values()[2]);
+    EXPECT_LT(reconstruction_error(matrix, svd), 1e-12);
+    EXPECT_LT(orthogonality_error(svd.u()), 1e-12);
+    EXPECT_LT(orthogonality_error(svd.v()), 1e-12);
+  }
+}
+
+TEST(SVDTest, WideMatrix)
+{
+  Matrix matrix = {{1, 0, 2, 1}, {0, 3, 1, 1}};
+  SVD svd(matrix);
+
+  ASSERT_EQ(svd.u().num_rows(), 2);
+  ASSERT_EQ(svd.u().num_collumns(), 2);
+  ASSERT_EQ(svd.v().num_rows(), 4);
+  ASSERT_EQ(svd.v().num_collumns(), 2);
+  EXPECT_LT(reconstruction_error(matrix, svd), 1e-12);
+}
+
+TEST(SVDTest, InPlace)
+{
+  Matrix matrix = {{3, 0}, {0, 4}, {0, 0}};
+  const Matrix copy = matrix;
+  const double *data = matrix.get_gsl_matrix()->data;
+
+  SVD svd(std::move(matrix), SVD::Method::Jacobi);
+
+  // U reuses the storage of the input, which is left empty
+  ASSERT_EQ(svd.u().get_gsl_matrix()->data, data);
+  ASSERT_EQ(matrix.num_rows(), 0);
+  EXPECT_NEAR(svd.singular_values()[0], 4.0, 1e-12);
+  EXPECT_NEAR(svd.singular_values()[1], 3.0, 1e-12);
+  EXPECT_LT(reconstruction_error(copy, svd), 1e-12);
+}
+
+TEST(SVDTest, Rank)
+{
+  Matrix matrix = {{1, 2, 3}, {2, 4, 6}, {1, 1, 1}};
+  SVD svd(matrix);
+
+  ASSERT_EQ(svd.rank(1e-10), 2);
+}
+
+TEST(SVDTest, EmptyMatrix)
+{
+  Matrix matrix = {};
+  ASSERT_THROW(SVD{std::move(matrix)}, std::range_error);
+}
@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+
+#include <gsl_wrapper/matrix.h>
+#include <gsl_wrapper/tiled-matrix.h>
+
+#include <cstdio>
+#include <string>
+
+using gsl_wrapper::Matrix;
+using gsl_wrapper::TiledMatrix;
+using gsl_wrapper::Vector;
+
+namespace
+{
+  // Tile file removed before and after the test, declare it before the
+  // matrices using it so it outlives their final flush
+  struct TileFile
+  {
+    explicit TileFile(const std::string &name)
+        : path{testing::TempDir() + "gsl_wrapper_" + name + ".tiles"}
+    {
+      std::remove(path.c_str());
+    }
+
+    ~TileFile()
+    {
+      std::remove(path.c_str());
+    }
+
+    std::string path;
+  };
+
+  auto fill(TiledMatrix &tiled, Matrix &reference, double offset) -> void
+  {
+    for (size_t i = 0; i < reference.num_rows(); i++)
+    {
+      for (size_t j = 0; j < reference.num_collumns(); j++)
+      {
+        reference[i][j] = offset + i * 0.5 - j * 0.25;
+        tiled.set(i, j, reference[i][j]);
+      }
+    }
+  }
+}
+
+TEST(TiledMatrixTest, ElementAccessAcrossEvictions)
+{
+  const size_t tile_bytes = 3 * 3 * sizeof(double);
+  TileFile file("access");
+  TiledMatrix tiled(file.path, 7, 5, 3, 2 * tile_bytes);
+  Matrix reference(7, 5);
+  fill(tiled, reference, 1.0);
+
+  ASSERT_EQ(tiled.num_tile_rows(), 3);
+  ASSERT_EQ(tiled.num_tile_collumns(), 2);
+  for (size_t i = 0; i < 7; i++)
+  {
+    for (size_t j = 0; j < 5; j++)
+    {
+      ASSERT_EQ(tiled.get(i, j), reference[i][j]);
+    }
+  }
+
+  TiledMatrix::Tile edge = tiled.read_tile(2, 1);
+  ASSERT_EQ(edge.view()->size1, 1);
+  ASSERT_EQ(edge.view()->size2, 2);
+
+  EXPECT_THROW({ tiled.get(7, 0); }, std::range_error);
+}
+
+TEST(TiledMatrixTest, PersistsToFile)
+{
+  TileFile file("persist");
+  {
+    TiledMatrix tiled(file.path, 4, 4, 2, 1);
+    tiled.set(3, 3, 42);
+  }
+
+  TiledMatrix reopened(file.path, 4, 4, 2, 1);
+  ASSERT_EQ(reopened.get(3, 3), 42);
+  ASSERT_EQ(reopened.get(0, 0), 0);
+}
+
+TEST(TiledMatrixTest, Multiplication)
+{
+  const size_t tile_bytes = 4 * 4 * sizeof(double);
+  TileFile lhs_file("lhs");
+  TileFile rhs_file("rhs");
+  TileFile result_file("result");
+  TiledMatrix lhs(lhs_file.path, 9, 6, 4, 3 * tile_bytes);
+  TiledMatrix rhs(rhs_file.path, 6, 10, 4, 3 * tile_bytes);
+  TiledMatrix result(result_file.path, 9, 10, 4, 3 * tile_bytes);
+
+  Matrix lhs_reference(9, 6);
+  Matrix rhs_reference(6, 10);
+  fill(lhs, lhs_reference, 1.0);
+  fill(rhs, rhs_reference, -2.0);
+
+  multiply(lhs, rhs, result);
+  Matrix expected = lhs_reference * rhs_reference;
+  for (size_t i = 0; i < 9; i++)
+  {
+    for (size_t j = 0; j < 10; j++)
+    {
+      ASSERT_NEAR(result.get(i, j), expected[i][j], 1e-12);
+    }
+  }
+
+  Vector x(6);
+  for (size_t i = 0; i < 6; i++)
+  {
+    x[i] = i + 1.0;
+  }
+  Vector y = multiply(lhs, x);
+  Matrix expected_y = lhs_reference * Matrix(x);
+  for (size_t i = 0; i < 9; i++)
+  {
+    ASSERT_NEAR(y[i], expected_y[i][0], 1e-12);
+  }
+
+  EXPECT_THROW({ multiply(rhs, rhs, result); }, std::runtime_error);
+}
+
+TEST(TiledMatrixTest, ElementwiseOperations)
+{
+  TileFile file("elementwise");
+  TileFile other_file("elementwise_other");
+  TiledMatrix tiled(file.path, 5, 5, 2, 1);
+  TiledMatrix other(other_file.path, 5, 5, 2, 1);
+  Matrix reference(5, 5);
+  Matrix other_reference(5, 5);
+  fill(tiled, reference, 3.0);
+  fill(other, other_reference, 1.0);
+
+  tiled.scale(2.0);
+  tiled.add(other);
+  tiled.apply([](double x)
+              { return x - 1.0; });
+
+  Matrix expected = reference * 2.0 + other_reference + (-1.0);
+  for (size_t i = 0; i < 5; i++)
+  {
+    for (size_t j = 0; j < 5; j++)
+    {
+      ASSERT_NEAR(tiled.get(i, j), expected[i][j], 1e-12);
+    }
+  }
+}
+
+TEST(TiledMatrixTest, PinnedTilesSurvivePrefetch)
+{
+  // Room for one tile, the pinned one stays while neighbours are prefetched
+  TileFile file("pinned");
+  TiledMatrix tiled(file.path, 4, 4, 2, 1);
+  {
+    TiledMatrix::Tile tile = tiled.write_tile(0, 0);
+    gsl_matrix_set(tile.view(), 1, 1, 7.0);
+    tiled.prefetch(0, 1);
+    tiled.prefetch(1, 0);
+    tiled.set(1, 3, 2.0);
+    ASSERT_EQ(gsl_matrix_get(tile.view(), 1, 1), 7.0);
+  }
+
+  tiled.flush();
+  TiledMatrix reopened(file.path, 4, 4, 2, 1);
+  ASSERT_EQ(reopened.get(1, 1), 7.0);
+  ASSERT_EQ(reopened.get(1, 3), 2.0);
+}
+
+TEST(TiledMatrixTest, WritesAfterFlushSurviveEviction)
+{
+  // Room for one tile, so reading another one evicts the written tile
+  TileFile file("flushed");
+  TiledMatrix tiled(file.path, 4, 4, 2, 1);
+  {
+    TiledMatrix::Tile tile = tiled.write_tile(0, 0);
+    gsl_matrix_set(tile.view(), 0, 0, 1.0);
+    tiled.flush();
+    gsl_matrix_set(tile.view(), 0, 0, 2.0);
+  }
+
+  ASSERT_EQ(tiled.get(3, 3), 0.0);
+  ASSERT_EQ(tiled.get(0, 0), 2.0);
+}
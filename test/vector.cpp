@@ -7,6 +7,9 @@
 #include <vector>
 #include <algorithm>
 #include <tuple>
+#include <cmath>
+#include <cstdint>
+#include <utility>
 
 using gsl_wrapper::Vector;
 
@@ -209,4 +212,183 @@ TEST(VectorTest, NumberMul)
       ASSERT_EQ(el, 10);
     }
   }
-}
\ No newline at end of file
+}
+
+TEST(VectorTest, InlineStorage)
+{
+  Vector small{1, 2, 3};
+  gsl_vector *view = small.get_gsl_vector();
+
+  ASSERT_NE(view, nullptr);
+  ASSERT_EQ(view->size, 3);
+  ASSERT_EQ(view->stride, 1);
+  ASSERT_EQ(view->owner, 0);
+  ASSERT_EQ(view->block, nullptr);
+  ASSERT_EQ(gsl_vector_get(view, 2), 3);
+
+  Vector large(Vector::inline_capacity + 1);
+  ASSERT_NE(large.get_gsl_vector()->block, nullptr);
+}
+
+TEST(VectorTest, InlineMove)
+{
+  Vector move_from{1, 2, 3};
+  Vector move_to = std::move(move_from);
+
+  ASSERT_EQ(move_from.get_gsl_vector(), nullptr);
+  ASSERT_EQ(move_from.size(), 0);
+  ASSERT_EQ(move_to.size(), 3);
+  ASSERT_EQ(move_to.get_gsl_vector()->data, move_to.begin());
+  ASSERT_EQ(move_to[2], 3);
+
+  Vector large(50);
+  large = std::move(move_to);
+  ASSERT_EQ(large.size(), 3);
+  ASSERT_EQ(large[0], 1);
+
+  Vector small{4};
+  small = Vector(50);
+  ASSERT_EQ(small.size(), 50);
+  ASSERT_NE(small.get_gsl_vector()->block, nullptr);
+}
+
+TEST(VectorTest, MixedStorageCopy)
+{
+  Vector small{1, 2};
+  Vector large(40);
+
+  large = small;
+  ASSERT_EQ(large.size(), 2);
+  ASSERT_TRUE(large == small);
+
+  small = Vector(40);
+  Vector copy = small;
+  ASSERT_EQ(copy.size(), 40);
+  ASSERT_NE(copy.get_gsl_vector(), small.get_gsl_vector());
+}
+
+TEST(VectorTest, CopyOnWrite)
+{
+  Vector original(50);
+  original.enable_copy_on_write();
+  original[3] = 7;
+
+  Vector copy = original;
+  ASSERT_TRUE(original.shares_storage());
+  ASSERT_EQ(std::as_const(copy).begin(), std::as_const(original).begin());
+  ASSERT_TRUE(copy == original);
+
+  for (auto &&el : copy)
+  {
+    el += 1;
+  }
+  ASSERT_FALSE(original.shares_storage());
+  ASSERT_EQ(original[3], 7);
+  ASSERT_EQ(copy[3], 8);
+
+  Vector scaled = original * 2;
+  ASSERT_EQ(scaled[3], 14);
+  ASSERT_EQ(original[3], 7);
+
+  Vector small{1, 2};
+  small.enable_copy_on_write();
+  Vector small_copy = small;
+  ASSERT_TRUE(small_copy.is_copy_on_write());
+  small_copy[0] = 5;
+  ASSERT_EQ(small[0], 1);
+
+  // Assigning a plain vector keeps the target copy on write
+  const Vector plain(50);
+  copy = plain;
+  ASSERT_TRUE(copy.is_copy_on_write());
+  Vector shared = copy;
+  ASSERT_TRUE(shared.shares_storage());
+}
+
+TEST(VectorTest, PhiloxKnownAnswers)
+{
+  // Known answer tests of the Random123 reference implementation
+  std::uint32_t x[4][gsl_wrapper::bits::philox_block] = {};
+  gsl_wrapper::bits::philox_rounds_block(0, 1, x);
+  ASSERT_EQ(x[0][0], 0x6627e8d5u);
+  ASSERT_EQ(x[1][0], 0xe169c58du);
+  ASSERT_EQ(x[2][0], 0xbc57ac4cu);
+  ASSERT_EQ(x[3][0], 0x9b00dbd8u);
+
+  x[0][0] = 0x243f6a88;
+  x[1][0] = 0x85a308d3;
+  x[2][0] = 0x13198a2e;
+  x[3][0] = 0x03707344;
+  gsl_wrapper::bits::philox_rounds_block(0x299f31d0a4093822, 1, x);
+  ASSERT_EQ(x[0][0], 0xd16cfe09u);
+  ASSERT_EQ(x[1][0], 0x94fdccebu);
+  ASSERT_EQ(x[2][0], 0x5001e420u);
+  ASSERT_EQ(x[3][0], 0x24126ea1u);
+}
+
+TEST(VectorTest, RandomFill)
+{
+  // Large enough to be split between threads
+  const size_t size = 200001;
+  Vector uniform(size);
+  uniform.fill_uniform(7, -1.0, 3.0);
+
+  double sum = 0.0;
+  for (double value : std::as_const(uniform))
+  {
+    ASSERT_GT(value, -1.0);
+    ASSERT_LT(value, 3.0);
+    sum += value;
+  }
+  ASSERT_NEAR(sum / size, 1.0, 0.02);
+
+  // The same values come out of one serial pass
+  std::vector<double> serial(size);
+  gsl_wrapper::bits::random_fill(7, gsl_wrapper::bits::RandomDistribution::Uniform, 0, size, serial.data(), 1,
+                                 gsl_wrapper::bits::uniform_pair(-1.0, 3.0));
+  for (size_t i = 0; i < size; i++)
+  {
+    ASSERT_EQ(std::as_const(uniform)[i], serial[i]);
+  }
+
+  // Ranges starting at odd indices pick the second half of a pair
+  double tail[3];
+  gsl_wrapper::bits::random_fill(7, gsl_wrapper::bits::RandomDistribution::Uniform, 1001, 1004, tail, 1,
+                                 gsl_wrapper::bits::uniform_pair(-1.0, 3.0));
+  ASSERT_EQ(tail[0], serial[1001]);
+  ASSERT_EQ(tail[2], serial[1003]);
+
+  Vector other(size);
+  other.fill_uniform(8, -1.0, 3.0);
+  ASSERT_NE(std::as_const(other)[0], std::as_const(uniform)[0]);
+}
+
+TEST(VectorTest, RandomDistributions)
+{
+  const size_t size = 100000;
+  Vector gaussian(size);
+  Vector exponential(size);
+  Vector lognormal(size);
+  gaussian.fill_gaussian(1, 2.0, 0.5);
+  exponential.fill_exponential(1, 3.0);
+  lognormal.fill_lognormal(1, 0.0, 0.25);
+
+  double mean = 0.0;
+  double square = 0.0;
+  double exponential_mean = 0.0;
+  double lognormal_mean = 0.0;
+  for (size_t i = 0; i < size; i++)
+  {
+    const double value = std::as_const(gaussian)[i];
+    mean += value / size;
+    square += value * value / size;
+    ASSERT_GT(std::as_const(exponential)[i], 0.0);
+    exponential_mean += std::as_const(exponential)[i] / size;
+    lognormal_mean += std::as_const(lognormal)[i] / size;
+  }
+
+  ASSERT_NEAR(mean, 2.0, 0.01);
+  ASSERT_NEAR(std::sqrt(square - mean * mean), 0.5, 0.01);
+  ASSERT_NEAR(exponential_mean, 3.0, 0.05);
+  ASSERT_NEAR(lognormal_mean, std::exp(0.25 * 0.25 / 2.0), 0.01);
+}